@@ -6,8 +6,11 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <algorithm>
+#include <chrono>
 #include <fstream>
 #include <iostream>
+#include <sstream>
 
 #include "mlir/IR/Dialect.h"
 #include "mlir/IR/MLIRContext.h"
@@ -26,13 +29,18 @@
 #include "mlir/Transforms/Passes.h"
 
 #include "llvm/ADT/StringRef.h"
+#include "llvm/ADT/StringSet.h"
 #include "llvm/IR/Module.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/InitLLVM.h"
 #include "llvm/Support/ErrorOr.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
 #include "llvm/Support/SourceMgr.h"
 #include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/ToolOutputFile.h"
 
@@ -40,6 +48,8 @@
 #include "EQueue/EQueueTraits.h"
 #include "EQueue/CommandProcessor.h"
 #include "EQueue/EQueueDialectGenerator.h"
+#include "EQueue/EQueuePasses.h"
+#include "EQueue/MappingSearch.h"
 
 static llvm::cl::opt<bool> generateInputFile(
     "generate-input-file",
@@ -52,6 +62,81 @@ static llvm::cl::opt<std::string> inputFilename(llvm::cl::Positional,
 static llvm::cl::opt<std::string>
     jsonFilename("json", llvm::cl::desc("Json filename"),
                    llvm::cl::value_desc("input json filename"), llvm::cl::init("../test/out.json"));
+static llvm::cl::opt<bool>
+    printStats("stats", llvm::cl::desc("Print simulation statistics"),
+               llvm::cl::init(false));
+static llvm::cl::opt<uint64_t>
+    seed("seed", llvm::cl::desc("Seed of the latency distributions"),
+         llvm::cl::init(1));
+static llvm::cl::opt<unsigned>
+    monteCarloRuns("monte-carlo",
+                   llvm::cl::desc("Simulate this many seeded runs and print "
+                                  "latency percentiles"),
+                   llvm::cl::init(0));
+static llvm::cl::opt<bool>
+    sensitivity("sensitivity",
+                llvm::cl::desc("Rank hardware parameters by their effect on "
+                               "the latency"),
+                llvm::cl::init(false));
+static llvm::cl::opt<double>
+    sensitivityDelta("sensitivity-delta",
+                     llvm::cl::desc("Relative change of each parameter in "
+                                    "the sensitivity runs"),
+                     llvm::cl::init(0.1));
+static llvm::cl::opt<bool>
+    verifyIncremental("verify-incremental",
+                      llvm::cl::desc("Check every incremental sensitivity or "
+                                     "-what-if run against a full rerun"),
+                      llvm::cl::init(false));
+static llvm::cl::list<std::string>
+    whatIf("what-if",
+           llvm::cl::desc("Simulate with checkpoints, then resume with these "
+                          "hardware parameters scaled"),
+           llvm::cl::value_desc("parameter=factor"), llvm::cl::CommaSeparated);
+static llvm::cl::opt<std::string>
+    whatIfEdit("what-if-edit",
+               llvm::cl::desc("Simulate with checkpoints, then resume with the "
+                              "program of this file, an edit of the input"),
+               llvm::cl::value_desc("filename"), llvm::cl::init(""));
+static llvm::cl::opt<std::string>
+    cacheDir("cache-dir",
+             llvm::cl::desc("Keep the analysis of each simulated program in "
+                            "this directory and reuse it for the same input"),
+             llvm::cl::value_desc("directory"), llvm::cl::init(""));
+static llvm::cl::list<std::string>
+    batchInputs("batch",
+                llvm::cl::desc("Simulate these files, or the .mlir files in "
+                               "these directories, concurrently"),
+                llvm::cl::value_desc("file or directory"), llvm::cl::ZeroOrMore);
+static llvm::cl::opt<std::string>
+    batchOutput("batch-output",
+                llvm::cl::desc("Directory of the trace and summary of each "
+                               "-batch input"),
+                llvm::cl::value_desc("directory"), llvm::cl::init("."));
+static llvm::cl::list<int64_t>
+    searchConv("search-conv",
+               llvm::cl::desc("Search tilings and loop orders of this "
+                              "convolution and write the best program"),
+               llvm::cl::value_desc("C,H,W,K,R,S"), llvm::cl::CommaSeparated);
+static llvm::cl::opt<unsigned>
+    searchCores("search-cores",
+                llvm::cl::desc("AIEngine cores of the -search-conv target"),
+                llvm::cl::init(4));
+static llvm::cl::opt<int64_t>
+    searchLocalMem("search-local-mem",
+                   llvm::cl::desc("Lines of SRAM of each core of the "
+                                  "-search-conv target"),
+                   llvm::cl::init(1024));
+static llvm::cl::opt<unsigned>
+    searchKeep("search-keep",
+               llvm::cl::desc("Mappings with the best estimates that "
+                              "-search-conv simulates"),
+               llvm::cl::init(8));
+static llvm::cl::opt<unsigned>
+    numThreads("threads",
+               llvm::cl::desc("Threads of the batch, search, Monte Carlo "
+                              "and sensitivity runs, 0 for all cores"),
+               llvm::cl::init(0));
 static llvm::cl::opt<std::string>
     outputFilename("o", llvm::cl::desc("Output filename"),
                    llvm::cl::value_desc("filename"), llvm::cl::init("-"));
@@ -82,7 +167,8 @@ static llvm::cl::opt<bool>
     showDialects("show-dialects",
                  llvm::cl::desc("Print the list of registered dialects"),
                  llvm::cl::init(false));
-mlir::OwningModuleRef loadFileAndProcessModule(mlir::MLIRContext &context) {
+mlir::OwningModuleRef loadFileAndProcessModule(mlir::MLIRContext &context,
+                                               std::string &cacheFile) {
   mlir::OwningModuleRef module;
 
 	llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> fileOrErr =
@@ -91,6 +177,12 @@ mlir::OwningModuleRef loadFileAndProcessModule(mlir::MLIRContext &context) {
 	  llvm::errs() << "Could not open input file: " << EC.message() << "\n";
 	  return nullptr;
 	}
+	bool cached = false;
+	if (!cacheDir.empty()) {
+	  llvm::sys::fs::create_directories(cacheDir);
+	  cacheFile = acdc::CommandProcessor::cacheFileFor(cacheDir, (*fileOrErr)->getBuffer());
+	  cached = llvm::sys::fs::exists(cacheFile);
+	}
 	llvm::SourceMgr sourceMgr;
 	sourceMgr.AddNewSourceBuffer(std::move(*fileOrErr), llvm::SMLoc());
 	module = mlir::parseSourceFile(sourceMgr, &context);
@@ -98,7 +190,8 @@ mlir::OwningModuleRef loadFileAndProcessModule(mlir::MLIRContext &context) {
 	  llvm::errs() << "Error can't load file " << inputFilename << "\n";
 	  return nullptr;
 	}
-	if (failed(mlir::verify(*module))) {
+	// the input of a cache file has been verified before
+	if (!cached && failed(mlir::verify(*module))) {
 	  llvm::errs() << "Error verifying MLIR module\n";
 	  return nullptr;
 	}
@@ -106,12 +199,233 @@ mlir::OwningModuleRef loadFileAndProcessModule(mlir::MLIRContext &context) {
 		return nullptr;
 	return module;
 }
+/// the ops of func in walk order, and the number of each value they define
+static void numberOps(mlir::FuncOp func, std::vector<mlir::Operation *> &ops,
+                      llvm::DenseMap<mlir::Value, unsigned> &ids) {
+  func.walk([&](mlir::Operation *op) {
+    ops.push_back(op);
+    for (mlir::Region &region : op->getRegions())
+      for (mlir::Block &block : region)
+        for (mlir::Value arg : block.getArguments())
+          ids.insert({arg, ids.size()});
+    for (mlir::Value result : op->getResults())
+      ids.insert({result, ids.size()});
+  });
+}
+/// give the ops of @graph in module the attributes of those in edited, so
+/// that a resume sees the edit; false when the programs differ in more than
+/// attributes and module is left as it was
+static bool applyAttributeEdits(mlir::ModuleOp module, mlir::ModuleOp edited) {
+  auto func = module.lookupSymbol<mlir::FuncOp>("graph");
+  auto editedFunc = edited.lookupSymbol<mlir::FuncOp>("graph");
+  if (!func || !editedFunc)
+    return false;
+  std::vector<mlir::Operation *> ops, editedOps;
+  llvm::DenseMap<mlir::Value, unsigned> ids, editedIds;
+  numberOps(func, ops, ids);
+  numberOps(editedFunc, editedOps, editedIds);
+  if (ops.size() != editedOps.size())
+    return false;
+  for (size_t i = 0; i < ops.size(); i++) {
+    mlir::Operation *op = ops[i], *e = editedOps[i];
+    auto types = op->getResultTypes(), editedTypes = e->getResultTypes();
+    if (op->getName() != e->getName() ||
+        op->getNumOperands() != e->getNumOperands() ||
+        types.size() != editedTypes.size() ||
+        !std::equal(types.begin(), types.end(), editedTypes.begin()))
+      return false;
+    for (unsigned j = 0; j < op->getNumOperands(); j++)
+      if (ids.lookup(op->getOperand(j)) != editedIds.lookup(e->getOperand(j)))
+        return false;
+  }
+  for (size_t i = 0; i < ops.size(); i++)
+    if (ops[i]->getAttrs() != editedOps[i]->getAttrs())
+      ops[i]->setAttrs(editedOps[i]->getAttrs());
+  return true;
+}
+/// simulate the input keeping checkpoints, then resume it with the -what-if
+/// parameters scaled and the attributes of the -what-if-edit program, and
+/// print both latencies
+static mlir::LogicalResult runWhatIf(acdc::CommandProcessor &proc,
+                                     mlir::ModuleOp module) {
+  std::map<std::string, double> changes;
+  for (auto &change : whatIf) {
+    auto param = llvm::StringRef(change).rsplit('=');
+    double factor;
+    if (param.second.empty() || param.second.getAsDouble(factor) || factor <= 0) {
+      llvm::errs() << "error: -what-if expects parameter=factor, not '" << change
+                   << "'\n";
+      return mlir::failure();
+    }
+    changes[param.first.str()] = factor;
+  }
+  acdc::Checkpoints checkpoints;
+  if (mlir::failed(proc.checkpoint(module, checkpoints)))
+    return mlir::failure();
+  llvm::outs() << "baseline time " << checkpoints.result.latency << "\n";
+  mlir::OwningModuleRef edited;
+  if (!whatIfEdit.empty()) {
+    edited = mlir::parseSourceFile(whatIfEdit, module.getContext());
+    if (!edited || failed(mlir::verify(*edited))) {
+      llvm::errs() << "Error can't load file " << whatIfEdit << "\n";
+      return mlir::failure();
+    }
+    // added, removed or rewired ops: the edited program runs from the start
+    if (!applyAttributeEdits(module, *edited)) {
+      if (mlir::failed(proc.checkpoint(*edited, checkpoints)))
+        return mlir::failure();
+      if (changes.empty()) {
+        llvm::outs() << "what-if time " << checkpoints.result.latency << "\n";
+        return mlir::success();
+      }
+    }
+  }
+  acdc::SimulationResult result;
+  if (mlir::failed(proc.resume(checkpoints, changes, result, verifyIncremental)))
+    return mlir::failure();
+  llvm::outs() << "what-if time " << result.latency;
+  if (result.resumedAt)
+    llvm::outs() << ", resumed at step " << result.resumedAt;
+  llvm::outs() << "\n";
+  return mlir::success();
+}
+/// simulate every -batch input on a thread pool, all parsed into context;
+/// writes <name>.json and <name>.txt with the trace and summary of each
+/// input to -batch-output and prints the throughput. Inputs of the same name
+/// from different directories are written as <name>-1, <name>-2, ...
+static int runBatch(mlir::MLIRContext &context) {
+  std::vector<std::string> files;
+  for (auto &input : batchInputs) {
+    if (!llvm::sys::fs::is_directory(input)) {
+      files.push_back(input);
+      continue;
+    }
+    std::error_code ec;
+    for (llvm::sys::fs::directory_iterator it(input, ec), end; it != end && !ec;
+         it.increment(ec))
+      if (llvm::sys::path::extension(it->path()) == ".mlir")
+        files.push_back(it->path());
+  }
+  std::sort(files.begin(), files.end());
+  std::vector<std::string> names(files.size());
+  llvm::StringSet<> taken;
+  for (unsigned i = 0; i < files.size(); i++) {
+    std::string stem = llvm::sys::path::stem(files[i]).str();
+    names[i] = stem;
+    for (unsigned k = 1; !taken.insert(names[i]).second; k++)
+      names[i] = stem + "-" + std::to_string(k);
+  }
+  llvm::sys::fs::create_directories(batchOutput);
+  if (!cacheDir.empty())
+    llvm::sys::fs::create_directories(cacheDir);
+
+  std::vector<int> failed(files.size(), 1);
+  std::vector<uint64_t> latencies(files.size());
+  auto start = std::chrono::steady_clock::now();
+  llvm::ThreadPool pool(llvm::hardware_concurrency(numThreads));
+  for (unsigned i = 0; i < files.size(); i++)
+    pool.async([&, i] {
+      auto file = llvm::MemoryBuffer::getFile(files[i]);
+      if (!file) {
+        llvm::errs() << "Could not open input file " << files[i] << "\n";
+        return;
+      }
+      std::string cacheFile;
+      if (!cacheDir.empty())
+        cacheFile = acdc::CommandProcessor::cacheFileFor(cacheDir, (*file)->getBuffer());
+      llvm::SourceMgr sourceMgr;
+      sourceMgr.AddNewSourceBuffer(std::move(*file), llvm::SMLoc());
+      mlir::OwningModuleRef module = mlir::parseSourceFile(sourceMgr, &context);
+      if (!module) {
+        llvm::errs() << "Error can't load file " << files[i] << "\n";
+        return;
+      }
+      std::stringstream traceStream;
+      std::string summary;
+      llvm::raw_string_ostream stats(summary);
+      acdc::CommandProcessor proc(traceStream, printStats, seed);
+      proc.setCacheFile(cacheFile);
+      proc.setStatsStream(stats);
+      failed[i] = mlir::failed(proc.run(module.get()));
+      latencies[i] = proc.getLatency();
+      stats << "latency: " << latencies[i] << (failed[i] ? " (failed)" : "") << "\n";
+
+      llvm::SmallString<128> base(batchOutput);
+      llvm::sys::path::append(base, names[i]);
+      std::ofstream json_fp(base.str().str() + ".json");
+      json_fp << traceStream.str();
+      std::ofstream summary_fp(base.str().str() + ".txt");
+      summary_fp << stats.str();
+    });
+  pool.wait();
+  double seconds = std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start).count();
+
+  unsigned failures = std::count(failed.begin(), failed.end(), 1);
+  llvm::outs() << llvm::format("%-40s %-24s %14s\n", "input", "output", "latency");
+  for (unsigned i = 0; i < files.size(); i++)
+    llvm::outs() << llvm::format("%-40s %-24s %14llu%s\n", files[i].c_str(),
+                                 names[i].c_str(),
+                                 (unsigned long long)latencies[i],
+                                 failed[i] ? " failed" : "");
+  llvm::outs() << files.size() << " inputs, " << failures << " failed, "
+               << llvm::format("%.3f s, %.2f inputs/s\n", seconds,
+                               seconds > 0 ? files.size() / seconds : 0.0);
+  return failures ? 1 : 0;
+}
+
+/// search mappings of the -search-conv layer and print the simulated ones;
+/// writes the program of the best one to -o and its trace to -json
+static int runSearch(mlir::MLIRContext &context) {
+  if (searchConv.size() != 6) {
+    llvm::errs() << "-search-conv takes C,H,W,K,R,S\n";
+    return 1;
+  }
+  acdc::ConvLayer layer{searchConv[0], searchConv[1], searchConv[2],
+                        searchConv[3], searchConv[4], searchConv[5]};
+  acdc::Hierarchy hierarchy{searchCores, searchLocalMem};
+  acdc::MappingSearch search(layer, hierarchy);
+  auto mappings = search.search(context, searchKeep, numThreads);
+  if (mappings.empty() || mappings[0].failed) {
+    llvm::errs() << "no mapping of the layer fits the target\n";
+    return 1;
+  }
+
+  llvm::outs() << llvm::format("%-40s %14s %14s\n", "mapping", "estimate", "latency");
+  for (auto &m : mappings) {
+    if (!m.simulated) break;
+    llvm::outs() << llvm::format("%-40s %14llu ", m.str().c_str(),
+                                 (unsigned long long)m.estimate);
+    if (m.failed)
+      llvm::outs() << llvm::format("%14s\n", "failed");
+    else
+      llvm::outs() << llvm::format("%14llu\n", (unsigned long long)m.latency);
+  }
+  llvm::outs() << mappings.size() << " candidates, best " << mappings[0].str()
+               << "\n";
+
+  std::string errorMessage;
+  auto output = mlir::openOutputFile(outputFilename, &errorMessage);
+  if (!output) {
+    llvm::errs() << errorMessage << "\n";
+    return 1;
+  }
+  // the program that was simulated, not a regenerated one
+  mappings[0].program->get().print(output->os());
+  output->os() << "\n";
+  output->keep();
+  std::ofstream json_fp(jsonFilename);
+  json_fp << mappings[0].trace;
+  return 0;
+}
+
 int main(int argc, char **argv) {
   mlir::registerAllDialects();
   mlir::registerAllPasses();
 
   // Register equeue passes here.
   mlir::registerDialect<xilinx::equeue::EQueueDialect>();
+  xilinx::equeue::registerEQueuePasses();
 
   llvm::InitLLVM y(argc, argv);
 
@@ -131,6 +445,11 @@ int main(int argc, char **argv) {
     }
     return 0;
   }
+  // one context for all inputs, it is multithreaded
+  if (!batchInputs.empty())
+    return runBatch(context);
+  if (!searchConv.empty())
+    return runSearch(context);
   
   std::string errorMessage;
   auto output = mlir::openOutputFile(outputFilename, &errorMessage);
@@ -156,17 +475,35 @@ int main(int argc, char **argv) {
                            allowUnregisteredDialects))) {
       return 1;
     }
+    // the diagnostics of an invalid input were checked, nothing to simulate
+    if (verifyDiagnostics) {
+      output->keep();
+      return 0;
+    }
 	  
-    auto module = loadFileAndProcessModule(context);
+    std::string cacheFile;
+    auto module = loadFileAndProcessModule(context, cacheFile);
+    if (!module)
+      return 1;
 	  PassManager pm(module->getContext());
 	  
 	  std::string json_fn;
 	  if (jsonFilename.c_str()) json_fn = jsonFilename.c_str();
 	  std::ofstream json_fp(json_fn);
 	  std::stringstream traceStream;
-	  acdc::CommandProcessor proc(traceStream);
-	  proc.run(module.get());
+	  acdc::CommandProcessor proc(traceStream, printStats, seed);
+	  proc.setCacheFile(cacheFile);
+	  auto result = !whatIf.empty() || !whatIfEdit.empty() ?
+	    runWhatIf(proc, module.get()) :
+	    sensitivity ?
+	    proc.runSensitivity(module.get(), sensitivityDelta, numThreads,
+	                        verifyIncremental) :
+	    monteCarloRuns ?
+	    proc.runMonteCarlo(module.get(), monteCarloRuns, numThreads) :
+	    proc.run(module.get());
     json_fp << traceStream.str();
+    if (failed(result))
+      return 1;
   }
   
 
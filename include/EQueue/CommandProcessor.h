@@ -6,41 +6,115 @@
 //
 //===----------------------------------------------------------------------===//
 
-#include "llvm/ADT/Any.h"
+#ifndef EQUEUE_COMMANDPROCESSOR_H
+#define EQUEUE_COMMANDPROCESSOR_H
+
+#include "EQueue/Interpreter.h"
 
 #include "mlir/Dialect/StandardOps/IR/Ops.h"
 #include "llvm/ADT/APInt.h"
 #include "llvm/ADT/APFloat.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/ErrorOr.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
 
 #include "mlir/IR/Function.h"
 #include "mlir/IR/MLIRContext.h"
 #include "mlir/IR/Module.h"
 #include "mlir/Dialect/SCF/SCF.h"
 #include "mlir/Dialect/StandardOps/IR/Ops.h"
+#include "mlir/Support/LogicalResult.h"
 
+#include <algorithm>
+#include <map>
+#include <memory>
 #include <ostream>
+#include <string>
+#include <vector>
 
 namespace acdc {
 
+/// outcome of simulating one function, see CommandProcessor::simulate
+struct SimulationResult {
+  uint64_t latency = 0;
+  bool failed = false;
+  // busy share of each launcher
+  std::map<std::string, double> utilization;
+  // step a resumed run continued from, 0 for a run from the start
+  uint64_t resumedAt = 0;
+};
+class Runner;
+/// a run that kept checkpoints of its state, see CommandProcessor::checkpoint;
+/// runs with changed hardware parameters or an edited program resume from them
+struct Checkpoints {
+  mlir::FuncOp toplevel;
+  std::shared_ptr<Runner> baseline;
+  SimulationResult result;
+};
+
 class CommandProcessor {
 
 public:
-    CommandProcessor(std::ostream &trace_stream) :
-      traceStream(trace_stream), verbose(true)
+    CommandProcessor(std::ostream &trace_stream, bool print_stats = false,
+                     uint64_t seed = 1) :
+      traceStream(trace_stream), verbose(true), printStats(print_stats), seed(seed),
+      statsStream(&llvm::outs()), latency(0)
     {
     }
 
     ~CommandProcessor() {}
 
-  void run(mlir::ModuleOp module);
+  /// fails if the program is invalid for the modeled hardware
+  mlir::LogicalResult run(mlir::ModuleOp module);
+  /// simulate func without a trace, e.g. as the cost model of a pass
+  SimulationResult simulate(mlir::FuncOp func);
+  /// simulate runs copies with seeds seed, seed+1, ... on threads threads
+  /// (0 for all cores) and print percentiles of the end-to-end latency
+  mlir::LogicalResult runMonteCarlo(mlir::ModuleOp module, unsigned runs,
+                                    unsigned threads = 0);
+  /// rerun with every hardware parameter scaled by 1 - delta and 1 + delta
+  /// and print the parameters ranked by their effect on the latency; the
+  /// reruns resume from checkpoints of the baseline, verify compares each
+  /// one against a full rerun
+  mlir::LogicalResult runSensitivity(mlir::ModuleOp module, double delta,
+                                     unsigned threads = 0, bool verify = false);
+  /// simulate the program of module like run, without a trace, and keep
+  /// checkpoints of the run in checkpoints
+  mlir::LogicalResult checkpoint(mlir::ModuleOp module, Checkpoints &checkpoints);
+  /// rerun the checkpointed program with hardware parameters scaled by the
+  /// factors in changes, e.g. {"DMA_0.transfer_rate", 0.5}, and with the
+  /// attributes its ops were given since, e.g. a loop bound constant, from
+  /// the latest checkpoint before any of them mattered. Other edits of the
+  /// program, added or removed ops, changed operands or frequencies, rerun it
+  /// from the start. A name that is not a parameter is an error. verify
+  /// compares the result with a full rerun
+  mlir::LogicalResult resume(const Checkpoints &checkpoints,
+                             const std::map<std::string, double> &changes,
+                             SimulationResult &result, bool verify = false);
+  /// run keeps the analysis of the program in this file and reuses it when
+  /// the file exists, see cacheFileFor
+  void setCacheFile(const std::string &path) { cacheFile = path; }
+  /// file in dir named after the hash of the program text
+  static std::string cacheFileFor(llvm::StringRef dir, llvm::StringRef text);
+  /// where run prints the summary, llvm::outs() by default
+  void setStatsStream(llvm::raw_ostream &os) { statsStream = &os; }
+  /// end-to-end latency of the last run
+  uint64_t getLatency() { return latency; }
 
 private:
   std::ostream &traceStream;
   bool verbose;
+  // print a summary of the simulation to statsStream
+  bool printStats;
+  // of the latency distributions, see the latency attribute
+  uint64_t seed;
+  // empty for none
+  std::string cacheFile;
+  llvm::raw_ostream *statsStream;
+  uint64_t latency;
 
 };
 struct OpEntry{
@@ -52,40 +126,184 @@ struct OpEntry{
   uint64_t start_time;
   uint64_t end_time;
   uint64_t queue_ready_time;
+  // pipeline lane of an overlapping op, -1 for in-order execution
+  int slot;
+  // launch and memcpy: operands as they were when the device accepted it
+  Snapshot values;
   bool is_started() { return start_time != 0 && end_time != 0; }
   bool is_done(uint64_t t) { return t >= end_time; }
 
-  OpEntry(mlir::Operation *o) : op(o), tid(0), start_time(0), end_time(0), queue_ready_time(0) {}
-  OpEntry(mlir::Operation *o, uint64_t id) : op(o), tid(id), start_time(0), end_time(0), queue_ready_time(0) {}
-  OpEntry() : op(nullptr), tid(0), start_time(0), end_time(0), queue_ready_time(0) {}
+  OpEntry(mlir::Operation *o) : op(o), tid(0), start_time(0), end_time(0), queue_ready_time(0), slot(-1) {}
+  OpEntry(mlir::Operation *o, uint64_t id) : op(o), tid(id), start_time(0), end_time(0), queue_ready_time(0), slot(-1) {}
+  OpEntry() : op(nullptr), tid(0), start_time(0), end_time(0), queue_ready_time(0), slot(-1) {}
 
 };
+
+// default depth of an event queue, see queue_depth on create_proc/create_dma
 #define EVENT_QUEUE_SIZE 2
+
+/// fixed-capacity FIFO, storage is allocated once when the capacity is set
+template <class T>
+class RingBuffer{
+  public:
+    RingBuffer(uint64_t capacity = EVENT_QUEUE_SIZE) : buffer(std::max(capacity, uint64_t(1))), head(0), count(0) {}
+    ~RingBuffer(){}
+    uint64_t size(){
+      return count;
+    }
+    uint64_t capacity(){
+      return buffer.size();
+    }
+    bool empty(){
+      return !count;
+    }
+    bool full(){
+      return count == buffer.size();
+    }
+    T &front(){
+      return buffer[head];
+    }
+    bool push_back(T t){
+      if (full()) return false;
+      buffer[(head + count) % buffer.size()] = t;
+      count++;
+      return true;
+    }
+    void pop_front(){
+      head = (head + 1) % buffer.size();
+      count--;
+    }
+    /// drops the content
+    void set_capacity(uint64_t capacity){
+      buffer.assign(std::max(capacity, uint64_t(1)), T());
+      head = 0;
+      count = 0;
+    }
+  private:
+    std::vector<T> buffer;
+    uint64_t head;
+    uint64_t count;
+};
+
+/// an op in an event queue; a launch or memcpy carries the values of its
+/// operands from when it was granted, see Interpreter::capture
+struct Event {
+  mlir::Operation *op;
+  Snapshot values;
+};
+
+/// a launch or memcpy another launcher wants to push into the event queue
+struct ArbiterRequest {
+  // id of the requesting launcher
+  uint64_t requester;
+  mlir::Operation *op;
+  uint64_t arrival;
+};
+
+/// waiting of one requester at an arbiter
+struct ArbiterStats {
+  uint64_t grants;
+  uint64_t total_wait;
+  uint64_t max_wait;
+  ArbiterStats() : grants(0), total_wait(0), max_wait(0) {}
+};
+
 struct LauncherTable {
   OpEntry op_entry;
   
   mlir::Block *block;
   mlir::Block::iterator next_iter;
 
-  llvm::SmallVector<mlir::Operation *, EVENT_QUEUE_SIZE> event_queue;
+  RingBuffer<Event> event_queue;
+
+  // backpressure: how often and how long this launcher could not push an
+  // event because the destination queue was full
+  std::string name;
+  uint64_t full_stalls;
+  uint64_t full_stall_cycles;
+  uint64_t full_since;
+  bool blocked_on_full;
+
+  // pipelined execution: op_entry is the issue slot, issued ops that overlap
+  // with later ones move to in_flight until their end_time
+  uint64_t issue_width;
+  uint64_t pipeline_depth;
+  llvm::SmallVector<OpEntry, 4> in_flight;
+  // scoreboard: results of in-flight ops and the time they become ready
+  llvm::DenseMap<mlir::Value, uint64_t> scoreboard;
+  uint64_t issue_cycle;
+  uint64_t issued;
+  // ticks of the global time base per cycle of the launcher
+  uint64_t tick;
+  // time spent executing ops, overlapping ones add up
+  uint64_t busy;
+
+  // arbitration: the host is 0, devices are numbered in creation order
+  uint64_t id;
+  // as a requester, for the priority and weighted policies of an arbiter
+  uint64_t priority;
+  uint64_t weight;
+  // a request of this launcher is pending at some arbiter
+  bool requesting;
+  // as an arbiter: fifo, round_robin, priority or weighted
+  std::string arbitration;
+  std::vector<ArbiterRequest> requests;
+  uint64_t last_grant;
+  std::map<uint64_t, ArbiterStats> waits;
+
   bool is_idle(){
-    return !op_entry.op;
+    return !op_entry.op && in_flight.empty();
+  }
+  /// idle with nothing left to fetch, e.g. a launch body that was accepted
+  /// but not started, or an op waiting for an arbiter
+  bool is_finished(){
+    return is_idle() && !next_op();
+  }
+  bool is_pipelined(){
+    return issue_width > 1 || pipeline_depth > 1;
+  }
+  int free_slot(){
+    for (int s = 0; ; s++){
+      bool used = false;
+      for (auto &e : in_flight)
+        used = used || e.slot == s;
+      if (!used) return s;
+    }
   }
   void set_block(mlir::Block *b){
     block = b;
     next_iter = b->begin();
   }
-  bool add_event_queue(mlir::Operation *o){
-    if(event_queue.size()==EVENT_QUEUE_SIZE) return false;
-    else event_queue.push_back(o);
-    return true;
+  /// the op to fetch next, nullptr at the end of the block
+  mlir::Operation *next_op(){
+    return block && next_iter != block->end() ? &*next_iter : nullptr;
+  }
+  void advance(){
+    next_iter++;
+  }
+  bool add_event_queue(mlir::Operation *o, Snapshot values = Snapshot()){
+    return event_queue.push_back({o, std::move(values)});
+  }
+  void block_on_full(uint64_t time){
+    if (blocked_on_full) return;
+    blocked_on_full = true;
+    full_since = time;
+    full_stalls++;
+  }
+  void unblock(uint64_t time){
+    if (!blocked_on_full) return;
+    blocked_on_full = false;
+    full_stall_cycles += time - full_since;
   }
   // bool operator==(const CommandQueueEntry& m) const {
   //       return (m.op == op);
   // }
   //TODO
   LauncherTable()
-    : op_entry(), block(nullptr) { }
+    : op_entry(), block(nullptr), full_stalls(0), full_stall_cycles(0),
+      full_since(0), blocked_on_full(false), issue_width(1), pipeline_depth(1),
+      issue_cycle(0), issued(0), tick(1), busy(0), id(0), priority(0), weight(1),
+      requesting(false), arbitration("fifo"), last_grant(0) { }
 };
 
 template <class K>
@@ -131,32 +349,7 @@ class ScopedMap{
 
 };
 
-template <class T> class Executor;
-
-struct VisitorInterface
-{
-  virtual ~VisitorInterface() = default;
-	virtual void Visit(Executor<mlir::ConstantIndexOp>&) = 0;
-	
-//    virtual void Visit(Component<float>&) = 0;
-};
-
-class ExecutorInterface{
-public:
-    virtual void runFunc(VisitorInterface&) = 0;
-};
-
-template <class T> class Executor : public ExecutorInterface {
-public:
-	Executor(T op, std::vector<llvm::Any> &in, std::vector<llvm::Any> &out) : op(op), in(in), out(out)
-  {
-  }
-
-  void runFunc(VisitorInterface &visitor) { visitor.Visit(*this); }
-	T op;
-  std::vector<llvm::Any> &in;
-  std::vector<llvm::Any> &out;
-};
 
+} // namespace acdc
 
-}
+#endif // EQUEUE_COMMANDPROCESSOR_H
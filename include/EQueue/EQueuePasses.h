@@ -0,0 +1,47 @@
+//===- EQueuePasses.h -------------------------------------------*- C++ -*-===//
+//
+// This file is licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef EQUEUE_PASSES_H
+#define EQUEUE_PASSES_H
+
+#include "EQueue/CommandProcessor.h"
+
+#include "mlir/Pass/Pass.h"
+
+#include <memory>
+
+namespace xilinx {
+namespace equeue {
+
+/// the simulation of a function as a cost model; functions named graph or
+/// carrying the equeue.entry attribute are simulated with the seed of their
+/// equeue.seed attribute, 1 without one
+struct SimulationAnalysis {
+  SimulationAnalysis(mlir::Operation *op);
+  static bool isEntry(mlir::FuncOp func);
+
+  // false for functions that are not simulated
+  bool simulated;
+  acdc::SimulationResult result;
+};
+
+/// simulate entry functions in parallel and attach equeue.latency and
+/// equeue.utilization to them
+std::unique_ptr<mlir::Pass> createSimulatePass();
+
+/// unroll loops of memcpy -> launch -> memcpy chains by two and give the
+/// odd iterations second buffers, where that lowers the simulated latency
+std::unique_ptr<mlir::Pass> createDoubleBufferPass();
+
+void registerDoubleBufferPass();
+void registerEQueuePasses();
+
+} // namespace equeue
+} // namespace xilinx
+
+#endif // EQUEUE_PASSES_H
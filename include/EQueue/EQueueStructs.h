@@ -20,9 +20,12 @@
 #include "mlir/IR/TypeSupport.h"
 #include "mlir/IR/Types.h"
 #include <string>
+#include <map>
 #include <cmath>
 #include <algorithm>    
 #include <vector>
+#include <memory>
+#include <random>
 #include <initializer_list>
 
 using namespace mlir;
@@ -35,23 +38,69 @@ namespace equeue {
 #define ENOUGH -1
 // unit conversion
 #define Bit *1
-#define Byte *1024 Bit
-#define KB *1024 Byte
-#define MB *1024 KB
-#define GB *1024 MB
+#define Byte *1024ull Bit
+#define KB *1024ull Byte
+#define MB *1024ull KB
+#define GB *1024ull MB
+
+//distribution of the latency factor of a device, see the latency attribute
+enum class LatencyDist { Fixed, Uniform, Normal, LogNormal };
 
 struct Device {
     //unique id
     uint64_t uid;
 
     std::vector<std::pair<uint64_t, uint64_t>> events;
-    //int clock_frequency;
+    //ticks of the global time base per cycle of this device, see frequency
+    uint64_t tick;
     int energy;
     //int area;
-    Device(uint64_t id) : uid(id), energy(1) {
+    //stochastic latency: every cost is scaled by a factor drawn from dist,
+    //spread is the relative half width (uniform) or deviation (normal, 
+    //lognormal). Each device draws from its own stream seeded by seed and uid.
+    LatencyDist dist;
+    double spread;
+    std::mt19937_64 rng;
+    Device(uint64_t id) : uid(id), tick(1), energy(1), dist(LatencyDist::Fixed), spread(0) {
         events.push_back(std::make_pair(0,0));
     }
     virtual ~Device() = default;
+    //deep copy for checkpoints of the simulation, pointers to other devices
+    //are remapped by the owner
+    virtual std::unique_ptr<Device> clone() const {
+        return std::make_unique<Device>(*this);
+    }
+    //convert cycle costs to ticks, called once after construction
+    virtual void setTick(uint64_t t){
+        tick = t;
+    }
+    void setLatency(LatencyDist d, double s, uint64_t seed){
+        dist = d;
+        spread = s;
+        std::seed_seq seq{uint32_t(seed), uint32_t(seed >> 32), uint32_t(uid)};
+        rng.seed(seq);
+    }
+    //cost of one access or transfer, whole cycles of the device
+    uint64_t sample(uint64_t c){
+        if(dist == LatencyDist::Fixed || !c || spread <= 0)
+            return c;
+        double f = 1;
+        switch(dist){
+        case LatencyDist::Uniform:
+            f = std::uniform_real_distribution<double>(1 - spread, 1 + spread)(rng);
+            break;
+        case LatencyDist::Normal:
+            f = std::normal_distribution<double>(1, spread)(rng);
+            break;
+        case LatencyDist::LogNormal:
+            //median at the nominal cost, long tail above
+            f = std::lognormal_distribution<double>(0, spread)(rng);
+            break;
+        default:
+            break;
+        }
+        return std::max<int64_t>(llround(c * f / tick), 1) * tick;
+    }
     void deleteOutdatedEvents(uint64_t now_time){
         auto it = events.begin();
         for(; it != events.end(); it++){
@@ -88,6 +137,21 @@ struct Device {
         events.insert(iter, std::make_pair(start_time, start_time+exec_time));
         return start_time+exec_time;
     }
+    //earliest time from t on when the device is free for len cycles
+    uint64_t firstFit(uint64_t t, uint64_t len){
+        for(auto &e : events){
+            if(t + len < e.first)
+                break;
+            if(t <= e.second)
+                t = e.second + 1;
+        }
+        return t;
+    }
+    //occupy the device at a slot found by firstFit, events stay sorted
+    void reserve(uint64_t start_time, uint64_t len){
+        auto e = std::make_pair(start_time, start_time+len);
+        events.insert(std::upper_bound(events.begin(), events.end(), e), e);
+    }
     template <class T>
     uint64_t  scheduleEvent(uint64_t start_time, uint64_t exec_time, std::initializer_list<T> dlist )
     {
@@ -113,24 +177,169 @@ struct Device {
 };
 
 
-struct DMA : public Device{
-    bool mode;
-    double transfer_rate;//volume per cycle
-    int warmup_cycles;//bus grant, bus request
-    //double transfer_rate_growth;//growth rate of rate
-    //int saturated_volume;
-    DMA(uint64_t id) : mode(BURST_MODE), transfer_rate(10 KB), warmup_cycles(2), Device(id) {}
-    int getTransferCycles(int volume){
-        return warmup_cycles + ceil(volume/transfer_rate);
-    }
-};
-
 constexpr unsigned int hash(const char *s, int off = 0) {                        
     return !s[off] ? 5381 : (hash(s, off+1)*33) ^ s[off];                           
 }    
 
 enum class MemOp { Read, Write };
 
+//data lines of an access as runs of contiguous lines (first line, lines)
+//in access order. Lines that follow each other in memory merge into one
+//run, which is accessed as a single burst.
+struct Region {
+    std::vector<std::pair<uint64_t, uint64_t>> runs;
+    uint64_t size;
+    Region() : size(0) {}
+    //s lines starting at addr, stride lines apart
+    Region(uint64_t addr, uint64_t s, uint64_t stride = 1) : size(0) {
+        if(stride == 1)
+            append(addr, s);
+        else
+            for(uint64_t i = 0; i < s; i++)
+                append(addr + i * stride, 1);
+    }
+    void append(uint64_t addr, uint64_t lines){
+        if(!lines) return;
+        size += lines;
+        if(!runs.empty() && runs.back().first + runs.back().second == addr)
+            runs.back().second += lines;
+        else
+            runs.push_back(std::make_pair(addr, lines));
+    }
+    bool overlaps(const Region &r) const {
+        for(auto &a : runs)
+            for(auto &b : r.runs)
+                if(a.first < b.first + b.second && b.first < a.first + a.second)
+                    return true;
+        return false;
+    }
+};
+
+enum class AllocPolicy { Bump, FreeList, Buddy };
+
+//allocator model of a memory. Free space is a set of disjoint intervals
+//(first line -> lines). bump only hands out lines above the highest live
+//allocation, freelist is first fit and merges freed intervals with their
+//neighbours, buddy rounds sizes up to powers of two and merges a freed
+//block with its buddy.
+struct Allocator {
+    AllocPolicy policy;
+    uint64_t capacity;
+    std::map<uint64_t, uint64_t> free_space;
+    std::map<uint64_t, uint64_t> live;//first line -> reserved lines
+    uint64_t top;//bump
+    uint64_t used;
+    uint64_t peak;
+    double max_fragmentation;
+
+    Allocator(uint64_t cap = 0, AllocPolicy p = AllocPolicy::FreeList){
+        reset(cap, p);
+    }
+    void reset(uint64_t cap, AllocPolicy p){
+        policy = p;
+        capacity = cap;
+        free_space.clear();
+        live.clear();
+        top = used = peak = 0;
+        max_fragmentation = 0;
+        if(policy == AllocPolicy::Buddy){
+            //largest aligned power of two blocks first
+            uint64_t addr = 0;
+            for(int k = 63; k >= 0; k--)
+                if(cap >> k & 1){
+                    free_space[addr] = uint64_t(1) << k;
+                    addr += uint64_t(1) << k;
+                }
+        }else if(cap){
+            free_space[0] = cap;
+        }
+    }
+    //returns false if no free interval is large enough
+    bool allocate(uint64_t lines, uint64_t &addr){
+        lines = std::max(lines, uint64_t(1));
+        if(policy == AllocPolicy::Bump){
+            if(top + lines > capacity) return false;
+            addr = top;
+            top += lines;
+        }else{
+            uint64_t size = lines;
+            if(policy == AllocPolicy::Buddy)
+                while(size & (size - 1)) size += size & -size;
+            //first fit, buddy takes the smallest block that fits
+            auto block = free_space.end();
+            for(auto it = free_space.begin(); it != free_space.end(); it++)
+                if(it->second >= size && (block == free_space.end() || 
+                    (policy == AllocPolicy::Buddy && it->second < block->second))){
+                    block = it;
+                    if(policy == AllocPolicy::FreeList) break;
+                }
+            if(block == free_space.end()) return false;
+            addr = block->first;
+            uint64_t len = block->second;
+            free_space.erase(block);
+            if(policy == AllocPolicy::Buddy){
+                while(len > size){
+                    len /= 2;
+                    free_space[addr + len] = len;
+                }
+            }else if(len > size){
+                free_space[addr + size] = len - size;
+            }
+            lines = size;
+        }
+        live[addr] = lines;
+        used += lines;
+        peak = std::max(peak, used);
+        max_fragmentation = std::max(max_fragmentation, fragmentation());
+        return true;
+    }
+    //returns false if nothing is allocated at addr
+    bool release(uint64_t addr){
+        auto it = live.find(addr);
+        if(it == live.end()) return false;
+        uint64_t size = it->second;
+        live.erase(it);
+        used -= size;
+        if(policy == AllocPolicy::Bump){
+            top = live.empty() ? 0 : live.rbegin()->first + live.rbegin()->second;
+        }else if(policy == AllocPolicy::Buddy){
+            while(true){
+                auto buddy = free_space.find(addr ^ size);
+                if(buddy == free_space.end() || buddy->second != size) break;
+                free_space.erase(buddy);
+                addr = std::min(addr, addr ^ size);
+                size *= 2;
+            }
+            free_space[addr] = size;
+        }else{
+            auto next = free_space.lower_bound(addr);
+            if(next != free_space.end() && addr + size == next->first){
+                size += next->second;
+                next = free_space.erase(next);
+            }
+            auto prev = next == free_space.begin() ? free_space.end() : std::prev(next);
+            if(prev != free_space.end() && prev->first + prev->second == addr)
+                prev->second += size;
+            else
+                free_space[addr] = size;
+        }
+        max_fragmentation = std::max(max_fragmentation, fragmentation());
+        return true;
+    }
+    uint64_t largestFree(){
+        if(policy == AllocPolicy::Bump) return capacity - top;
+        uint64_t largest = 0;
+        for(auto &block : free_space)
+            largest = std::max(largest, block.second);
+        return largest;
+    }
+    //share of the free lines that are not in the largest free interval
+    double fragmentation(){
+        uint64_t free_lines = capacity - used;
+        return free_lines ? 1 - double(largestFree()) / free_lines : 0;
+    }
+};
+
 struct Memory : public Device {
     int read_ports;
     int write_ports;
@@ -138,14 +347,15 @@ struct Memory : public Device {
     int data_size;
     int total_size;
     int total_volume;
-    int default_volume;
+    uint64_t default_volume;
     int cycles_per_data;//cycles to handle a set of read or write
     int min_cycles;
     int cycles;
+    Allocator allocator;
     //int cache_size;
     //latency
 
-    Memory(uint64_t id, int rp, int wp, int de_vol, int dlines, std::string dtype, 
+    Memory(uint64_t id, int rp, int wp, uint64_t de_vol, int dlines, std::string dtype, 
         int cyc_per_data, int min_cyc) : Device(id) {
         read_ports = rp;
         write_ports = wp;
@@ -176,24 +386,471 @@ struct Memory : public Device {
         cycles_per_data = cyc_per_data;
         min_cycles= min_cyc;
         cycles = std::max(cyc_per_data*int(round(total_volume/de_vol)), min_cyc);
+        setBanks(1, 1, true);
+        allocator.reset(dlines, AllocPolicy::FreeList);
+    }
+
+    std::unique_ptr<Device> clone() const {
+        return std::make_unique<Memory>(*this);
+    }
+    void setTick(uint64_t t){
+        Device::setTick(t);
+        cycles *= t;
+        min_cycles *= t;
+    }
+
+    //scale the cost of an access, for sensitivity analysis, before setTick;
+    //returns the factor the cost actually changed by in whole cycles
+    virtual double scaleCycles(double f){
+        int nominal = std::max(cycles_per_data*int(round(total_volume/default_volume)), min_cycles);
+        cycles_per_data = std::max(int(llround(cycles_per_data * f)), 1);
+        min_cycles = std::max(int(llround(min_cycles * f)), 1);
+        cycles = std::max(cycles_per_data*int(round(total_volume/default_volume)), min_cycles);
+        return double(cycles) / nominal;
+    }
+
+    //cost of dlines lines through the read or write ports, before sampling
+    int accessCycles(int dlines, MemOp op){
+        int ports = op == MemOp::Read ? read_ports : write_ports;
+        return (ports == ENOUGH)? cycles : (dlines + ports - 1) / ports * cycles;
     }
 
     int getReadOrWriteCycles(int dlines, MemOp op){
-        if(op == MemOp::Read)
-            return (read_ports == ENOUGH)? cycles : ceil(dlines / read_ports)*cycles;
-        if(op == MemOp::Write)
-            return (write_ports == ENOUGH)? cycles : ceil(dlines / read_ports)*cycles;
-        return -1;
+        return sample(accessCycles(dlines, op));
+    }
+
+    int getReadOrWriteCycles(const Region &r, MemOp op){
+        int cycles = 0;
+        for(auto &run : r.runs)
+            cycles += getReadOrWriteCycles(run.second, op);
+        return cycles;
+    }
+
+    //banks: a banked memory keeps one timeline per port of each bank instead
+    //of the single events timeline, accesses only hold the banks they touch
+    int banks;
+    int ports_per_bank;
+    bool cyclic;//interleaving, cyclic: line % banks, block: line / bank_lines
+    std::vector<uint64_t> port_busy;//banks * ports_per_bank, busy until
+
+    virtual void setBanks(int b, int ports, bool cyc){
+        banks = std::max(b, 1);
+        ports_per_bank = std::max(ports, 1);
+        cyclic = cyc;
+        port_busy.assign(banks * ports_per_bank, 0);
+    }
+    bool isBanked(){
+        return banks > 1 || ports_per_bank > 1;
+    }
+    //number of lines in [addr, addr+lines) that map to bank b
+    uint64_t linesInBank(int b, uint64_t addr, uint64_t lines){
+        if(cyclic){
+            uint64_t first = (b + banks - addr % banks) % banks;
+            return lines > first ? (lines - first + banks - 1) / banks : 0;
+        }
+        uint64_t bank_lines = std::max((data_lines + banks - 1) / banks, 1);
+        uint64_t lo = std::max(addr, b * bank_lines);
+        //addresses past the end belong to the last bank
+        uint64_t hi = (b == banks - 1) ? addr + lines : std::min(addr + lines, (b + 1) * bank_lines);
+        return hi > lo ? hi - lo : 0;
+    }
+    uint64_t portFree(int b){
+        auto first = port_busy.begin() + b * ports_per_bank;
+        return *std::min_element(first, first + ports_per_bank) + 1;
+    }
+    //earliest time the ports the lines map to are free
+    virtual uint64_t freeAfter(uint64_t addr, uint64_t lines){
+        if(!isBanked())
+            return (events.end()-1)->second+1;
+        uint64_t t = 0;
+        for(int b = 0; b < banks; b++)
+            if(linesInBank(b, addr, lines))
+                t = std::max(t, portFree(b));
+        return t;
+    }
+    //hold the ports the lines map to from start to end
+    virtual void occupy(uint64_t start, uint64_t end, uint64_t addr, uint64_t lines){
+        if(!isBanked()){
+            events.push_back(std::make_pair(start, end));
+            return;
+        }
+        for(int b = 0; b < banks; b++){
+            uint64_t n = std::min(linesInBank(b, addr, lines), uint64_t(ports_per_bank));
+            auto first = port_busy.begin() + b * ports_per_bank;
+            for(uint64_t i = 0; i < n; i++){
+                auto port = std::min_element(first, first + ports_per_bank);
+                *port = std::max(*port, end);
+            }
+        }
+    }
+    //slot for a single line, used by cycle stealing transfers
+    virtual uint64_t fitLine(uint64_t t, uint64_t addr, uint64_t len){
+        return isBanked() ? std::max(t, freeAfter(addr, 1)) : firstFit(t, len);
+    }
+    virtual void holdLine(uint64_t start, uint64_t len, uint64_t addr){
+        if(isBanked()) occupy(start, start+len, addr, 1);
+        else reserve(start, len);
+    }
+    //memory whose address space buffers on this memory are allocated in
+    virtual Memory *backing(){
+        return this;
+    }
+    //time at which lines starting at addr can be moved by a transfer that
+    //starts at start, for memories whose latency depends on the address
+    virtual uint64_t accessEnd(uint64_t start, uint64_t addr, uint64_t lines){
+        return start;
+    }
+    //region versions of the above, run by run
+    uint64_t regionFree(const Region &r){
+        uint64_t t = 0;
+        for(auto &run : r.runs)
+            t = std::max(t, freeAfter(run.first, run.second));
+        return t;
+    }
+    uint64_t regionEnd(uint64_t start, const Region &r){
+        uint64_t t = start;
+        for(auto &run : r.runs)
+            t = std::max(t, accessEnd(start, run.first, run.second));
+        return t;
+    }
+    void occupyRegion(uint64_t start, uint64_t end, const Region &r){
+        for(auto &run : r.runs)
+            occupy(start, end, run.first, run.second);
+    }
+    //runs are issued together, ports, banks and buses order them
+    uint64_t scheduleRegion(uint64_t start_time, const Region &r, MemOp op){
+        uint64_t t = start_time;
+        for(auto &run : r.runs)
+            t = std::max(t, scheduleAccess(start_time, run.first, run.second, op));
+        return t;
+    }
+    //read or write lines starting at addr, returns the end time
+    virtual uint64_t scheduleAccess(uint64_t start_time, uint64_t addr, int dlines, MemOp op){
+        if(!isBanked())
+            return scheduleEvent(start_time, getReadOrWriteCycles(dlines, op), true);
+        //each bank spreads its lines over its ports, banks work in parallel;
+        //a port pays its share of the unbanked cost of the access, so
+        //banking never makes an access without conflicts slower
+        uint64_t lines = std::max(dlines, 1);
+        uint64_t total = accessCycles(dlines, op);
+        uint64_t end_time = start_time;
+        for(int b = 0; b < banks; b++){
+            uint64_t n = linesInBank(b, addr, dlines);
+            if(!n) continue;
+            auto first = port_busy.begin() + b * ports_per_bank;
+            uint64_t used = std::min(n, uint64_t(ports_per_bank));
+            uint64_t per_port = (n + ports_per_bank - 1) / ports_per_bank;
+            //in whole ticks of the memory
+            uint64_t cost = (per_port * total + lines - 1) / lines;
+            cost = (cost + tick - 1) / tick * tick;
+            for(uint64_t i = 0; i < used; i++){
+                auto port = std::min_element(first, first + ports_per_bank);
+                uint64_t start = std::max(start_time, *port + 1);
+                *port = start + sample(cost);
+                end_time = std::max(end_time, *port);
+            }
+        }
+        return end_time;
+    }
+};
+
+struct DMA : public Device{
+    bool mode;
+    double transfer_rate;//volume per cycle
+    int warmup_cycles;//bus grant, bus request
+    //double transfer_rate_growth;//growth rate of rate
+    //int saturated_volume;
+    //independent channels, each one transfer at a time
+    int channels;
+    std::vector<uint64_t> channel_busy;
+    DMA(uint64_t id, int ch = 1, bool m = BURST_MODE) : Device(id), mode(m), transfer_rate(10 KB), 
+        warmup_cycles(2), channels(std::max(ch, 1)), channel_busy(std::max(ch, 1), 0) {}
+    std::unique_ptr<Device> clone() const {
+        return std::make_unique<DMA>(*this);
+    }
+    void setTick(uint64_t t){
+        Device::setTick(t);
+        warmup_cycles *= t;
+    }
+    //every burst pays the warmup
+    int getTransferCycles(int volume, int bursts = 1){
+        return sample(bursts * warmup_cycles + int(ceil(volume/transfer_rate)) * tick);
+    }
+    int freeChannel(){
+        return std::min_element(channel_busy.begin(), channel_busy.end()) - channel_busy.begin();
+    }
+    //burst mode locks source and destination for the whole transfer,
+    //cycle stealing moves one data line per beat and lets other accesses
+    //to the memories interleave between beats
+    uint64_t scheduleTransfer(uint64_t start_time, uint64_t exec_time, 
+        Memory *src, const Region &src_r, Memory *dest, const Region &dest_r){
+        int ch = freeChannel();
+        start_time = std::max(start_time, channel_busy[ch]+1);
+        uint64_t beats = std::min(src_r.size, dest_r.size);
+        uint64_t end_time;
+        if(mode == BURST_MODE || beats <= 1){
+            start_time = std::max({start_time, src->regionFree(src_r), dest->regionFree(dest_r)});
+            end_time = std::max({start_time + exec_time, src->regionEnd(start_time, src_r), 
+                dest->regionEnd(start_time, dest_r)});
+            src->occupyRegion(start_time, end_time, src_r);
+            dest->occupyRegion(start_time, end_time, dest_r);
+        }else{
+            uint64_t t = start_time;
+            //position in the runs of source and destination
+            size_t src_run = 0, dest_run = 0;
+            uint64_t src_pos = 0, dest_pos = 0;
+            for(uint64_t i = 0; i < beats; i++){
+                uint64_t beat = std::max(exec_time / beats + (i < exec_time % beats), uint64_t(1));
+                uint64_t src_line = src_r.runs[src_run].first + src_pos;
+                uint64_t dest_line = dest_r.runs[dest_run].first + dest_pos;
+                if(++src_pos == src_r.runs[src_run].second){ src_run++; src_pos = 0; }
+                if(++dest_pos == dest_r.runs[dest_run].second){ dest_run++; dest_pos = 0; }
+                //slot where both memories are free
+                uint64_t s = t;
+                while(true){
+                    uint64_t s_src = src->fitLine(s, src_line, beat);
+                    s = dest->fitLine(s_src, dest_line, beat);
+                    if(s == s_src) break;
+                }
+                beat = std::max({beat, src->accessEnd(s, src_line, 1) - s, 
+                    dest->accessEnd(s, dest_line, 1) - s});
+                src->holdLine(s, beat, src_line);
+                dest->holdLine(s, beat, dest_line);
+                if(i == 0) start_time = s;
+                t = s + beat + 1;
+            }
+            end_time = t - 1;
+        }
+        events.push_back(std::make_pair(start_time, end_time));
+        channel_busy[ch] = end_time;
+        return end_time;
     }
 };
 
+
 struct SRAM : public Memory {
    SRAM(uint64_t id, int dlines, std::string dtype) : Memory(id, ENOUGH, ENOUGH, 10 KB, dlines, dtype, 
         5, 2) {}
+   std::unique_ptr<Device> clone() const {
+        return std::make_unique<SRAM>(*this);
+   }
 };
+//DRAM with a row buffer per bank. Consecutive rows go to consecutive banks,
+//an access to the open row of a bank is a hit, to a closed bank a miss and
+//to a bank with another row open a conflict that first precharges the bank.
+//Banks activate rows in parallel, data moves over one shared bus, and every
+//t_refi cycles all banks refresh for t_rfc cycles and close their rows.
 struct DRAM : public Memory {
+   int row_lines;//data lines per row
+   int t_cas;//column access
+   int t_rcd;//row activation
+   int t_rp;//precharge
+   int t_burst;//cycles per data line on the bus
+   uint64_t t_refi;
+   uint64_t t_rfc;
+   std::vector<int64_t> open_row;//per bank, -1 if closed
+   uint64_t bus_busy;
+   uint64_t refresh_epoch;
+   //statistics
+   uint64_t row_hits, row_misses, row_conflicts, refreshes;
+   uint64_t lines_moved, first_access, last_access;
+
    DRAM(uint64_t id, int dlines, std::string dtype) : Memory(id, ENOUGH, ENOUGH, 512 MB, dlines, dtype, 
-        40, 5) {}
+        40, 5), row_lines(256), t_cas(5), t_rcd(5), t_rp(5), t_burst(1), t_refi(7800), t_rfc(350), 
+        bus_busy(0), refresh_epoch(0), row_hits(0), row_misses(0), row_conflicts(0), refreshes(0), 
+        lines_moved(0), first_access(0), last_access(0) {
+        setBanks(8, 1, true);
+   }
+   std::unique_ptr<Device> clone() const {
+        return std::make_unique<DRAM>(*this);
+   }
+   void setTick(uint64_t t){
+        Memory::setTick(t);
+        t_cas *= t;
+        t_rcd *= t;
+        t_rp *= t;
+        t_burst *= t;
+        t_refi *= t;
+        t_rfc *= t;
+   }
+   void setBanks(int b, int ports, bool cyc){
+        Memory::setBanks(b, ports, cyc);
+        open_row.assign(banks, -1);
+   }
+   //the row timings make the cost of an access
+   double scaleCycles(double f){
+        Memory::scaleCycles(f);
+        int nominal = t_cas + t_rcd + t_rp;
+        t_cas = std::max(int(llround(t_cas * f)), 1);
+        t_rcd = std::max(int(llround(t_rcd * f)), 1);
+        t_rp = std::max(int(llround(t_rp * f)), 1);
+        return double(t_cas + t_rcd + t_rp) / nominal;
+   }
+   //first time from t on outside a refresh, closes all rows after a refresh
+   uint64_t refresh(uint64_t t){
+        uint64_t epoch = t / t_refi;
+        if(epoch > refresh_epoch){
+            refreshes += epoch - refresh_epoch;
+            refresh_epoch = epoch;
+            std::fill(open_row.begin(), open_row.end(), -1);
+        }
+        if(epoch && t % t_refi < t_rfc)
+            t = epoch * t_refi + t_rfc;
+        return t;
+   }
+   uint64_t accessEnd(uint64_t start, uint64_t addr, uint64_t lines){
+        uint64_t end_time = start;
+        if(!lines_moved) first_access = start;
+        lines_moved += lines;
+        //one row activation per run of lines in the same row
+        while(lines){
+            uint64_t run = std::min(lines, row_lines - addr % row_lines);
+            uint64_t r = addr / row_lines;
+            int b = r % banks;
+            int64_t row = r / banks;
+            uint64_t ready = refresh(std::max(start, portFree(b)));
+            uint64_t latency;
+            if(open_row[b] == row){
+                latency = t_cas;
+                row_hits++;
+            }else if(open_row[b] < 0){
+                latency = t_rcd + t_cas;
+                row_misses++;
+            }else{
+                latency = t_rp + t_rcd + t_cas;
+                row_conflicts++;
+            }
+            latency = sample(latency);
+            open_row[b] = row;
+            uint64_t data = std::max(ready + latency, bus_busy + 1);
+            bus_busy = data + run * t_burst;
+            auto port = std::min_element(port_busy.begin() + b * ports_per_bank, 
+                port_busy.begin() + (b + 1) * ports_per_bank);
+            *port = bus_busy;
+            end_time = std::max(end_time, bus_busy);
+            addr += run;
+            lines -= run;
+        }
+        last_access = std::max(last_access, end_time);
+        return end_time;
+   }
+   uint64_t freeAfter(uint64_t addr, uint64_t lines){
+        return bus_busy + 1;
+   }
+   void occupy(uint64_t start, uint64_t end, uint64_t addr, uint64_t lines){
+        bus_busy = std::max(bus_busy, end);
+   }
+   uint64_t fitLine(uint64_t t, uint64_t addr, uint64_t len){
+        return std::max(t, bus_busy + 1);
+   }
+   void holdLine(uint64_t start, uint64_t len, uint64_t addr){
+        occupy(start, start + len, addr, 1);
+   }
+   uint64_t scheduleAccess(uint64_t start_time, uint64_t addr, int dlines, MemOp op){
+        return accessEnd(start_time, addr, dlines);
+   }
+   double rowHitRate(){
+        uint64_t total = row_hits + row_misses + row_conflicts;
+        return total ? double(row_hits) / total : 0;
+   }
+   //bytes per cycle of the DRAM clock while the DRAM was in use, the
+   //access times are in ticks of the global time base
+   double bandwidth(){
+        uint64_t ticks = last_access > first_access ? last_access - first_access : 1;
+        return double(lines_moved) * data_size / 8 * tick / ticks;
+   }
+};
+//set associative write-back, write-allocate cache in front of a parent
+//memory. Buffers allocated on the cache live in the address space of the
+//parent, reads and writes look up a flat tag array with LRU replacement,
+//misses fetch the line from the parent and dirty victims are written back.
+struct Cache : public Memory {
+    Memory *parent;
+    int assoc;
+    int line_size;//data lines per cache line
+    int hit_latency;
+    int miss_latency;
+    int sets;
+    //sets * assoc ways, allocated once
+    std::vector<uint64_t> tags;
+    std::vector<uint64_t> last_use;
+    std::vector<uint8_t> state;
+    uint64_t use_clock;
+    //statistics
+    uint64_t hits, misses, writebacks;
+
+    enum : uint8_t { Valid = 1, Dirty = 2 };
+
+    Cache(uint64_t id, int dlines, std::string dtype, Memory *p, int a, int ls, int hit, int miss) 
+        : Memory(id, ENOUGH, ENOUGH, 10 KB, dlines, dtype, 5, 2), parent(p), 
+        assoc(std::max(a, 1)), line_size(std::max(ls, 1)), hit_latency(hit), miss_latency(miss), 
+        use_clock(0), hits(0), misses(0), writebacks(0) {
+        sets = std::max(dlines / (assoc * line_size), 1);
+        tags.assign(sets * assoc, 0);
+        last_use.assign(sets * assoc, 0);
+        state.assign(sets * assoc, 0);
+    }
+    std::unique_ptr<Device> clone() const {
+        return std::make_unique<Cache>(*this);
+    }
+    void setTick(uint64_t t){
+        Memory::setTick(t);
+        hit_latency *= t;
+        miss_latency *= t;
+    }
+    //a hit and a miss make the cost of an access
+    double scaleCycles(double f){
+        Memory::scaleCycles(f);
+        int nominal = hit_latency + miss_latency;
+        hit_latency = std::max(int(llround(hit_latency * f)), 1);
+        miss_latency = std::max(int(llround(miss_latency * f)), 1);
+        return double(hit_latency + miss_latency) / nominal;
+    }
+    Memory *backing(){
+        return parent ? parent->backing() : this;
+    }
+    //look up one cache line, returns the time the line is available
+    uint64_t lookup(uint64_t t, uint64_t line, MemOp op){
+        uint64_t tag = line / sets;
+        int first = (line % sets) * assoc;
+        int victim = first;
+        for(int w = first; w < first + assoc; w++){
+            if((state[w] & Valid) && tags[w] == tag){
+                hits++;
+                last_use[w] = ++use_clock;
+                if(op == MemOp::Write) state[w] |= Dirty;
+                return t + sample(hit_latency);
+            }
+            if(!(state[w] & Valid) || ((state[victim] & Valid) && last_use[w] < last_use[victim]))
+                victim = w;
+        }
+        misses++;
+        t += sample(miss_latency);
+        if(parent){
+            if(state[victim] & Dirty){
+                writebacks++;
+                t = parent->scheduleAccess(t, (tags[victim] * sets + line % sets) * line_size, 
+                    line_size, MemOp::Write);
+            }
+            t = parent->scheduleAccess(t, line * line_size, line_size, MemOp::Read);
+        }
+        tags[victim] = tag;
+        last_use[victim] = ++use_clock;
+        state[victim] = Valid | (op == MemOp::Write ? Dirty : 0);
+        return t;
+    }
+    uint64_t scheduleAccess(uint64_t start_time, uint64_t addr, int dlines, MemOp op){
+        uint64_t start = std::max(start_time, freeAfter(addr, dlines));
+        uint64_t t = start;
+        uint64_t last = addr + std::max(dlines, 1) - 1;
+        for(uint64_t line = addr / line_size; line <= last / line_size; line++)
+            t = lookup(t, line, op);
+        occupy(start, t, addr, dlines);
+        return t;
+    }
+    double hitRate(){
+        return hits + misses ? double(hits) / (hits + misses) : 0;
+    }
 };
 
 } // namespace equeue
@@ -0,0 +1,113 @@
+//===- Interpreter.h --------------------------------------------*- C++ -*-===//
+//
+// This file is licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// The functional side of the simulator: std, scf and affine arithmetic is
+// evaluated over a register file with one slot per SSA value, so loop bounds
+// and indices may depend on values computed while the program runs.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef EQUEUE_INTERPRETER_H
+#define EQUEUE_INTERPRETER_H
+
+#include "mlir/IR/Function.h"
+#include "mlir/Dialect/SCF/SCF.h"
+#include "mlir/IR/AffineExpr.h"
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/Optional.h"
+#include "llvm/ADT/SmallVector.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace acdc {
+
+/// integers of any width, index and i1 are kept as int64_t, floats as
+/// double; the type of the value a register belongs to tells which
+union Register {
+  int64_t i;
+  double f;
+};
+
+/// values of some operands at one point of the run, None for one that
+/// cannot be computed
+using Snapshot = llvm::SmallVector<llvm::Optional<Register>, 4>;
+
+class Interpreter {
+public:
+  /// number the values of toplevel and allocate the register file; the
+  /// region arguments of a launch have registers of their own, see bind
+  void build(mlir::FuncOp &toplevel);
+  /// the numbering of an earlier build without walking the program, e.g.
+  /// from the analysis cache: values[i] gets register registerOf[i], none if
+  /// that is numRegisters
+  void restore(llvm::ArrayRef<mlir::Value> values,
+               llvm::ArrayRef<uint64_t> registerOf, unsigned numRegisters);
+  /// register of v, getNumRegisters() if v has none
+  unsigned getRegister(mlir::Value v) const;
+  unsigned getNumRegisters() const { return registers.size(); }
+
+  /// compute the results of op, false if op is not arithmetic or one of its
+  /// operands is unknown
+  bool execute(mlir::Operation *op);
+
+  /// arithmetic that has not been executed yet is evaluated on demand; a
+  /// value that cannot be computed, e.g. one loaded from memory, is reported
+  /// once as an operand of user and read as 0, see hasFailed
+  int64_t getInt(mlir::Value v, mlir::Operation *user);
+  double getFloat(mlir::Value v, mlir::Operation *user);
+  /// None for a value that cannot be computed, without a report
+  llvm::Optional<int64_t> tryGetInt(mlir::Value v);
+  /// the current values of vs, e.g. the operands of a launch or memcpy when
+  /// the device accepts it; the host may have moved on when it starts
+  Snapshot capture(mlir::ValueRange vs);
+  /// vs take the values of a capture, e.g. the region arguments of a launch
+  /// when it starts
+  void bind(mlir::ValueRange vs, const Snapshot &values);
+
+  /// a value the program needs was reported as unknown
+  bool hasFailed() const { return failed; }
+
+  /// iterations of forOp with the current values of its bounds
+  llvm::Optional<int64_t> getTripCount(mlir::scf::ForOp forOp);
+
+  /// the induction variable starts at the lower bound, iteration arguments
+  /// at their initial values; a loop without iterations yields those. Bounds
+  /// that cannot be computed are reported on forOp
+  void enterLoop(mlir::scf::ForOp forOp);
+  /// step the induction variable, the yielded values become the iteration
+  /// arguments
+  void nextIteration(mlir::scf::ForOp forOp);
+  /// the yielded values become the results of forOp
+  void exitLoop(mlir::scf::ForOp forOp);
+
+private:
+  void number(mlir::Block &block);
+  bool read(mlir::Value v, Register &r);
+  void write(mlir::Value v, Register r);
+  void copy(mlir::ValueRange from, mlir::ValueRange to);
+  bool evaluate(mlir::Operation *op);
+  bool evaluateAffine(mlir::AffineExpr expr, mlir::ValueRange dims,
+                      mlir::ValueRange syms, int64_t &result);
+  void reportUnknown(mlir::Value v, mlir::Operation *user);
+
+  // dense value ids
+  llvm::DenseMap<mlir::Value, unsigned> slots;
+  std::vector<Register> registers;
+  // the register holds a computed value
+  llvm::BitVector defined;
+  // unknown values are reported once
+  llvm::DenseSet<mlir::Value> reported;
+  bool failed = false;
+};
+
+} // namespace acdc
+
+#endif // EQUEUE_INTERPRETER_H
@@ -0,0 +1,91 @@
+//===- MappingSearch.h ------------------------------------------*- C++ -*-===//
+//
+// This file is licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// Search over the tilings and loop orders of a convolution on an accel with
+// a number of AIEngine cores. Candidates are generated as equeue programs,
+// ranked by an analytical estimate, and the best ones are simulated.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef EQUEUE_MAPPINGSEARCH_H
+#define EQUEUE_MAPPINGSEARCH_H
+
+#include "mlir/IR/MLIRContext.h"
+#include "mlir/IR/Module.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace acdc {
+
+/// K output channels of (H - R + 1) x (W - S + 1) from C input channels of
+/// H x W with K filters of C x R x S, stride 1
+struct ConvLayer {
+  int64_t C, H, W, K, R, S;
+  int64_t outH() const { return H - R + 1; }
+  int64_t outW() const { return W - S + 1; }
+};
+
+/// an ARMr5 host with a shared SRAM and a DMA, and cores AIEngines with
+/// localLines lines of SRAM each
+struct Hierarchy {
+  unsigned cores;
+  int64_t localLines;
+};
+
+/// output tiles of th x tw x tk; order names the tile loops outermost first,
+/// e.g. "khw", the outermost one is distributed over the cores
+struct Mapping {
+  int64_t th, tw, tk;
+  std::string order;
+  unsigned cores;
+  uint64_t estimate;
+  // after simulation
+  bool simulated;
+  bool failed;
+  uint64_t latency;
+  std::string trace;
+  // the simulated program, shared by copies of the mapping
+  std::shared_ptr<mlir::OwningModuleRef> program;
+
+  Mapping() : th(1), tw(1), tk(1), cores(1), estimate(0), simulated(false),
+              failed(false), latency(0) {}
+  std::string str() const;
+};
+
+class MappingSearch {
+public:
+  MappingSearch(const ConvLayer &layer, const Hierarchy &hierarchy)
+    : layer(layer), hierarchy(hierarchy) {}
+
+  /// tilings that divide the output and fit the local memory of a core,
+  /// each with every loop order
+  std::vector<Mapping> enumerate() const;
+  /// cycles of the busier of the slowest core and the shared DMA, from the
+  /// nominal costs of the SRAM and DMA models
+  uint64_t estimate(const Mapping &m) const;
+  /// the program of m; the data live tile by tile in the shared SRAM, every
+  /// core copies its tiles in, computes and copies the output tile back
+  mlir::OwningModuleRef generate(mlir::MLIRContext &context,
+                                 const Mapping &m) const;
+  /// estimate all candidates, simulate the keep best on threads threads (0
+  /// for all cores) with traces and programs; simulated mappings first,
+  /// fastest first
+  std::vector<Mapping> search(mlir::MLIRContext &context, unsigned keep,
+                              unsigned threads = 0) const;
+
+private:
+  ConvLayer layer;
+  Hierarchy hierarchy;
+};
+
+} // namespace acdc
+
+#endif // EQUEUE_MAPPINGSEARCH_H
@@ -12,7 +12,23 @@
 #include "EQueue/EQueueOps.h"
 #include "EQueue/EQueueTraits.h"
 #include "EQueue/EQueueStructs.h"
-
+#include "EQueue/Interpreter.h"
+
+#include "mlir/Dialect/Affine/IR/AffineOps.h"
+#include "mlir/IR/Builders.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringSwitch.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/ThreadPool.h"
+
+#include <chrono>
+#include <functional>
+#include <limits>
 #include <list>
 #include <deque>
 #include <vector>
@@ -21,19 +37,25 @@
 #include <string>
 #include <float.h>
 
-#define INDEX_WIDTH 32
 #define DEBUG_TYPE "command_processor"
 static bool verbose = false;
 using namespace mlir;
 namespace acdc {
 
-//using ExecFunc = void (*)(T, std::vector<llvm::Any> &, std::vector<llvm::Any> &);//op, in, out
-struct Visitor : VisitorInterface{
-	void Visit(Executor<mlir::ConstantIndexOp>& exec) override {
-
-		auto attr = exec.op.getAttrOfType<mlir::IntegerAttr>("value");
-		exec.out[0] = attr.getValue().sextOrTrunc(INDEX_WIDTH);
-	}
+/// owning device pointer that clones the device when copied, so a copy of a
+/// Runner is a checkpoint of the simulation
+struct DeviceHandle : std::unique_ptr<xilinx::equeue::Device> {
+  using Base = std::unique_ptr<xilinx::equeue::Device>;
+  DeviceHandle() = default;
+  template <class T>
+  DeviceHandle(std::unique_ptr<T> &&p) : Base(std::move(p)) {}
+  DeviceHandle(DeviceHandle &&) = default;
+  DeviceHandle &operator=(DeviceHandle &&) = default;
+  DeviceHandle(const DeviceHandle &o) : Base(o ? o->clone() : nullptr) {}
+  DeviceHandle &operator=(const DeviceHandle &o){
+    reset(o ? o->clone().release() : nullptr);
+    return *this;
+  }
 };
 
 class Runner {
@@ -41,40 +63,28 @@ class Runner {
   const int TRACE_PID_QUEUE=0;
   const int TRACE_PID_ALLOC=1;
   const int TRACE_PID_EQUEUE=2;
-
-
-#if 0
-void executeOp(mlir::Op op,
-               std::vector<llvm::Any> &in,
-               std::vector<llvm::Any> &out) {
-}
-#endif
+  // overlapping ops of pipelined launchers, one pid per lane
+  const int TRACE_PID_PIPELINE=3;
+  // MHz, of the host and of devices without a frequency attribute
+  const uint64_t DEFAULT_FREQUENCY=1000;
+  // steps at the same time, each changing some state, before the watchdog
+  // reports a livelock
+  const uint64_t WATCHDOG_STEPS=1<<20;
+  // checkpoints kept for incremental re-simulation
+  const size_t MAX_CHECKPOINTS=64;
+  // first word of a cache file, the last byte is the format version
+  const uint64_t CACHE_MAGIC=0x4551434143484503;
 
 public:
 
-  Runner(std::ostream &trace_stream) : traceStream(trace_stream), time(1), deviceId(0)
+  Runner(std::ostream &trace_stream, uint64_t seed = 1) : traceStream(trace_stream), time(1),
+    deviceId(0), seed(seed)
   {
+    hostTable.name = "host";
   }
 
 
 
-std::string printAnyValueWithType(mlir::Type type, llvm::Any &value) {
-  std::stringstream out;
-  if(type.isa<mlir::IntegerType>() ||
-     type.isa<mlir::IndexType>()) {
-    out << llvm::any_cast<llvm::APInt>(value).getSExtValue();
-    return out.str();
-  } else if(type.isa<mlir::FloatType>()) {
-    out << llvm::any_cast<llvm::APFloat>(value).convertToDouble();
-    return out.str();
-  } else if(type.isa<mlir::NoneType>()) {
-    return "none";
-  } else {
-    llvm_unreachable("Unknown result type!");
-  }
-}
-
-
 void emitTraceStart(std::ostream &s)
 {
   s << "[\n";
@@ -85,6 +95,32 @@ void emitTraceEnd(std::ostream &s)
   s << "{}]\n";
 }
 
+/// trace timestamps are in microseconds: cycles when no device has a
+/// frequency, otherwise real time printed exactly from integer ticks
+std::string formatTime(uint64_t t)
+{
+  if (!timeBase) return std::to_string(t);
+  // timeBase ticks make a microsecond, print 6 digits of the fraction
+  uint64_t frac = (t % timeBase) * 1000000 / timeBase;
+  std::string digits = std::to_string(frac);
+  return std::to_string(t / timeBase) + "." + std::string(6 - digits.size(), '0') + digits;
+}
+
+/// counter event: lines in use and fragmentation of a memory's allocator
+void emitAllocatorTrace(xilinx::equeue::Memory *mem)
+{
+  if (!tracing) return;
+  traceStream << "{\n";
+  traceStream << "  \"name\": \"" << memoryNames[mem] << " allocation\"," << "\n";
+  traceStream << "  \"cat\": \"allocator\"," << "\n";
+  traceStream << "  \"ph\": \"C\"," << "\n";
+  traceStream << "  \"ts\": " << formatTime(time) << "," << "\n";
+  traceStream << "  \"pid\": " << TRACE_PID_ALLOC << "," << "\n";
+  traceStream << "  \"args\": " << "{\"lines\": " << mem->allocator.used
+    << ", \"fragmentation\": " << mem->allocator.fragmentation() << "}" << "\n";
+  traceStream << "},\n";
+}
+
 void emitTraceEvent(std::ostream &s,
                     std::string name,
                     std::string cat,
@@ -92,11 +128,12 @@ void emitTraceEvent(std::ostream &s,
                     int64_t start_time,
                     int64_t tid,
                     int64_t pid) {
+  if (!tracing) return;
   s << "{\n";
   s << "  \"name\": \"" << name << "\"," << "\n";
   s << "  \"cat\": \""<< cat << "\"," << "\n";
   s << "  \"ph\": \""<< ph << "\"," << "\n";
-  s << "  \"ts\": " << start_time << "," << "\n";
+  s << "  \"ts\": " << formatTime(start_time) << "," << "\n";
   s << "  \"pid\": " << pid << "," << "\n";
   s << "  \"tid\": " << tid << "," << "\n";
   s << "  \"args\": " << "{}" << "" << "\n";
@@ -104,83 +141,320 @@ void emitTraceEvent(std::ostream &s,
 }
 
 
+/// the alloc a buffer lives in, looking through views
 xilinx::equeue::MemAllocOp getAllocOp(Value memRef){
-  return valueIds[memRef].getDefiningOp<xilinx::equeue::MemAllocOp>();
+  Value v = valueIds[memRef];
+  while (auto op = v.getDefiningOp()){
+    if (mlir::isa<xilinx::equeue::SplitContainerOp>(op) ||
+        mlir::isa<xilinx::equeue::ConcatContainerOp>(op))
+      v = valueIds[op->getOperand(0)];
+    else
+      break;
+  }
+  return v.getDefiningOp<xilinx::equeue::MemAllocOp>();
+}
+/// line ranges (first line, lines) of the memory a buffer covers, in order
+void getRanges(mlir::Value memRef, xilinx::equeue::Region &ranges){
+  Value v = valueIds[memRef];
+  auto op = v.getDefiningOp();
+  if (auto Op = llvm::dyn_cast_or_null<xilinx::equeue::SplitContainerOp>(op)){
+    xilinx::equeue::Region buffer;
+    getRanges(Op.getBuffer(), buffer);
+    unsigned view = v.cast<OpResult>().getResultNumber();
+    sliceRanges(buffer, Op.getOffset(view), Op.getSize(view), ranges);
+  } else if (llvm::dyn_cast_or_null<xilinx::equeue::ConcatContainerOp>(op)){
+    for (Value operand : op->getOperands())
+      getRanges(operand, ranges);
+  } else if (auto Op = llvm::dyn_cast_or_null<xilinx::equeue::MemAllocOp>(op)){
+    uint64_t dlines = 1;
+    for (auto s : Op.getShape())
+      dlines *= s;
+    ranges.append(allocAddr[op], dlines);
+  }
+}
+/// append lines [offset, offset+size) of a buffer, lines past its end
+/// continue after its last line
+void sliceRanges(const xilinx::equeue::Region &buffer, uint64_t offset, uint64_t size,
+                 xilinx::equeue::Region &ranges){
+  for (auto &run : buffer.runs){
+    if (!size) return;
+    if (offset >= run.second){
+      offset -= run.second;
+      continue;
+    }
+    uint64_t lines = std::min(size, run.second - offset);
+    ranges.append(run.first + offset, lines);
+    size -= lines;
+    offset = 0;
+  }
+  if (size && !buffer.runs.empty()){
+    auto &last = buffer.runs.back();
+    ranges.append(last.first + last.second + offset, size);
+  }
 }
 int getMemVolume(mlir::Value memRef){
-  auto allocOp = getAllocOp(memRef);
+  xilinx::equeue::Region ranges;
+  getRanges(memRef, ranges);
+  return ranges.size;
+}
+/// lines of a buffer from offset on, stride lines apart; op is reported if
+/// they run past the end of the buffer
+xilinx::equeue::Region getRegion(mlir::Operation *op, mlir::Value memRef, uint64_t offset,
+                                 uint64_t size, uint64_t stride = 1){
+  xilinx::equeue::Region buffer, region;
+  getRanges(memRef, buffer);
+  uint64_t last = offset + (size ? size - 1 : 0) * stride;
+  if (size && last >= buffer.size){
+    op->emitError("accesses lines ") << offset << " to " << last
+      << " of a buffer of " << buffer.size << " lines";
+    failed = true;
+  }
+  if (stride == 1){
+    sliceRanges(buffer, offset, size, region);
+    return region;
+  }
+  for (uint64_t i = 0; i < size; i++)
+    sliceRanges(buffer, offset + i * stride, 1, region);
+  return region;
+}
+xilinx::equeue::Memory *getMemory(mlir::Value memRef){
+  auto key = valueIds[getAllocOp(memRef).getMemHandler()];
+  return static_cast<xilinx::equeue::Memory *>(deviceMap[key].get());
+}
+
+/// accesses through different buffers to the same lines while one of them
+/// is still being written, i.e. views that alias each other race
+void trackOverlap(xilinx::equeue::Memory *mem, mlir::Value memRef,
+                  const xilinx::equeue::Region &region, bool write,
+                  uint64_t start, uint64_t end = 0){
+  if (!hasViews) return;
+  auto &writes = pendingWrites[mem];
+  Value buffer = valueIds[memRef];
+  writes.erase(std::remove_if(writes.begin(), writes.end(),
+    [&](PendingWrite &w){ return w.end < start; }), writes.end());
+  for (auto &w : writes){
+    if (w.buffer != buffer && w.region.overlaps(region)){
+      overlapConflicts++;
+      LLVM_DEBUG(llvm::dbgs() << "[overlap] buffer access @ " << start
+        << " overlaps a write through another view until " << w.end << "\n");
+    }
+  }
+  if (write)
+    writes.push_back({buffer, region, end});
+}
+/// row-major line offset of the indices into a buffer, views are indexed
+/// by the shape of their type; op is reported if an index is not known
+uint64_t getOffset(mlir::Operation *op, mlir::Value memRef, mlir::ValueRange indices){
+  llvm::SmallVector<int64_t, 8> shape;
+  if (auto allocOp = valueIds[memRef].getDefiningOp<xilinx::equeue::MemAllocOp>()){
+    for (auto s : allocOp.getShape())
+      shape.push_back(s);
+  } else {
+    auto type = memRef.getType().cast<xilinx::equeue::EQueueContainerType>().getValueType();
+    if (auto shaped = type.dyn_cast<ShapedType>())
+      shape.append(shaped.getShape().begin(), shaped.getShape().end());
+  }
+  int64_t offset = 0;
+  unsigned dim = 0;
+  for (Value index : indices){
+    int64_t stride = 1;
+    for (unsigned d = dim + 1; d < shape.size(); d++)
+      stride *= shape[d];
+    auto value = interp.tryGetInt(index);
+    if (!value){
+      op->emitError("index ") << dim << " is not known to the simulator";
+      failed = true;
+    }
+    offset += value.getValueOr(0) * stride;
+    dim++;
+  }
+  return std::max(offset, int64_t(0));
+}
+
+void createMemory(xilinx::equeue::CreateMemOp Op, uint64_t uid, const std::string &name)
+{
+  mlir::Operation *op = Op.getOperation();
+  auto shape = Op.getShape();
   int dlines = 1;
-  for (auto s : allocOp.getShape()){
+  for (auto s : shape){
     dlines *= s;
   }
-  return dlines;
+  auto dtype = Op.getDataType().str();
+  auto key = valueIds[op->getResults()[0]];
+  dlines = intKnob(name + ".size", dlines, uid, 1);
+  if (Op.getMemType() == "DRAM"){
+    deviceMap[key] = std::make_unique<xilinx::equeue::DRAM>(uid, dlines, dtype);
+    drams.push_back(static_cast<xilinx::equeue::DRAM *>(deviceMap[key].get()));
+  } else if (Op.getMemType() == "SRAM")
+    deviceMap[key] = std::make_unique<xilinx::equeue::SRAM>(uid, dlines, dtype);
+  else if (Op.getMemType() == "Cache"){
+    xilinx::equeue::Memory *parent = nullptr;
+    if (Op.parent())
+      parent = static_cast<xilinx::equeue::Memory *>(deviceMap[valueIds[Op.parent()]].get());
+    deviceMap[key] = std::make_unique<xilinx::equeue::Cache>(uid, dlines, dtype, parent,
+      Op.getAssoc(), Op.getLineSize(), Op.getHitLatency(), Op.getMissLatency());
+    caches.push_back(static_cast<xilinx::equeue::Cache *>(deviceMap[key].get()));
+  } else
+    llvm_unreachable("No such memory type.\n");
+  auto mem = static_cast<xilinx::equeue::Memory *>(deviceMap[key].get());
+  mem->setBanks(Op.getBanks(mem->banks), Op.getPortsPerBank(), Op.isCyclicInterleave());
+  auto costs = name + ".cycles_per_data";
+  double factor = mem->scaleCycles(knob(costs, 1, uid));
+  if (perturbation.count(costs)) applied[costs] = factor;
+  mem->setTick(getTick(op));
+  setLatency(mem, op);
+  auto policy = llvm::StringSwitch<xilinx::equeue::AllocPolicy>(Op.getAllocator())
+    .Case("bump", xilinx::equeue::AllocPolicy::Bump)
+    .Case("buddy", xilinx::equeue::AllocPolicy::Buddy)
+    .Default(xilinx::equeue::AllocPolicy::FreeList);
+  mem->allocator.reset(dlines, policy);
+  memoryNames[mem] = name;
+  memories.push_back(mem);
+  deviceOps[uid] = op;
 }
 
-uint64_t modelOp(const uint64_t &time, OpEntry &c)
+void createDMA(xilinx::equeue::CreateDMAOp Op, uint64_t uid, const std::string &name)
+{
+  mlir::Operation *op = Op.getOperation();
+  auto key = valueIds[op->getResults()[0]];
+  auto dma = std::make_unique<xilinx::equeue::DMA>(uid, Op.getChannels(),
+    Op.isBurstMode() ? BURST_MODE : STEAL_CYECLE_MODE);
+  dma->transfer_rate = knob(name + ".transfer_rate", dma->transfer_rate, uid);
+  dma->warmup_cycles = intKnob(name + ".warmup_cycles", dma->warmup_cycles, uid, 0);
+  dma->setTick(getTick(op));
+  deviceMap[key] = std::move(dma);
+  setLatency(deviceMap[key].get(), op);
+  deviceOps[uid] = op;
+}
+
+/// first step a memory, or the memory behind a cache, is used
+void touch(xilinx::equeue::Device *device)
+{
+  firstUse.insert({device->uid, step});
+}
+void touch(xilinx::equeue::Memory *mem)
+{
+  firstUse.insert({mem->uid, step});
+  firstUse.insert({mem->backing()->uid, step});
+}
+
+uint64_t modelOp(const uint64_t &time, OpEntry &c, uint64_t tick = 1)
 {
   LLVM_DEBUG(llvm::dbgs()<<"[modelOp] start model op\n");
   mlir::Operation *op = c.op;
-  uint64_t execution_time = 1;
+  // one cycle of the launcher
+  uint64_t execution_time = tick;
   if (auto Op = mlir::dyn_cast<xilinx::equeue::CreateMemOp>(op)) {
-    auto shape = Op.getShape();
-    int dlines = 1;
-    for (auto s : shape){
-      dlines *= s;
-    }
-    auto dtype = Op.getDataType().str();
-    auto key = valueIds[op->getResults()[0]];
-    if (Op.getMemType() == "DRAM")
-      deviceMap[key] = std::make_unique<xilinx::equeue::DRAM>(deviceId++, dlines, dtype);
-    else if (Op.getMemType() == "SRAM")
-      deviceMap[key] = std::make_unique<xilinx::equeue::SRAM>(deviceId++, dlines, dtype);
-    else
-      llvm_unreachable("No such memory type.\n");
+    auto name = Op.getMemType().str() + "_" + std::to_string(memoryCounts[Op.getMemType()]++);
+    createMemory(Op, deviceId++, name);
   }
   else if (auto Op = mlir::dyn_cast<xilinx::equeue::CreateDMAOp>(op)) {
-    auto key = valueIds[op->getResults()[0]];
-    deviceMap[key] = std::make_unique<xilinx::equeue::DMA>(deviceId++);
+    // named like its launcher, see retireOp
+    createDMA(Op, deviceId++, "DMA_" + std::to_string(launchTables.size()));
+  }
+  else if (auto Op = mlir::dyn_cast<xilinx::equeue::MemAllocOp>(op)) {
+    auto key = valueIds[Op.getMemHandler()];
+    touch(static_cast<xilinx::equeue::Memory *>(deviceMap[key].get()));
+    auto mem = static_cast<xilinx::equeue::Memory *>(deviceMap[key].get())->backing();
+    uint64_t lines = getMemVolume(op->getResult(0));
+    uint64_t addr = 0;
+    if (!mem->allocator.allocate(lines, addr)){
+      op->emitError("cannot allocate ") << lines << " lines on " << memoryNames[mem]
+        << ": " << mem->allocator.used << " of " << mem->allocator.capacity
+        << " lines in use, largest free block " << mem->allocator.largestFree();
+      failed = true;
+    }
+    allocAddr[op] = addr;
+    emitAllocatorTrace(mem);
+  }
+  else if (mlir::isa<xilinx::equeue::MemDeallocOp>(op)) {
+    for (Value buffer : op->getOperands()){
+      if (!buffer.getType().isa<xilinx::equeue::EQueueContainerType>()) continue;
+      auto allocOp = getAllocOp(buffer);
+      touch(getMemory(buffer));
+      auto mem = getMemory(buffer)->backing();
+      if (!mem->allocator.release(allocAddr[allocOp.getOperation()])){
+        op->emitError("buffer deallocated on ") << memoryNames[mem] << " is not allocated";
+        failed = true;
+      }
+      emitAllocatorTrace(mem);
+    }
+  }
+  else if (mlir::isa<xilinx::equeue::ConcatContainerOp>(op)) {
+    auto mem = getMemory(op->getOperand(0));
+    for (Value operand : op->getOperands())
+      if (getMemory(operand) != mem){
+        op->emitError("concat_container operands must live on the same memory");
+        failed = true;
+        break;
+      }
   }
   else if (auto Op = mlir::dyn_cast<xilinx::equeue::MemReadOp>(op)) {
+    // a single line at an index, the whole buffer otherwise
     int dlines = Op.hasOffset() ? 1 : getMemVolume( Op.getBuffer() );
-    auto key = valueIds[getAllocOp(Op.getBuffer()).getMemHandler()];
-    auto mem = static_cast<xilinx::equeue::Memory *>(deviceMap[key].get());
+    auto mem = getMemory(Op.getBuffer());
     c.mem_tids.push_back(mem->uid);
-    execution_time = mem->getReadOrWriteCycles(dlines, xilinx::equeue::MemOp::Read);
-    return mem->scheduleEvent(time, execution_time, true);
+    touch(mem);
+    auto region = getRegion(op, Op.getBuffer(), getOffset(op, Op.getBuffer(), Op.getIndex()),
+      Op.getSize(dlines), Op.getStride());
+    trackOverlap(mem, Op.getBuffer(), region, false, time);
+    return mem->scheduleRegion(time, region, xilinx::equeue::MemOp::Read);
   }
   else if (auto Op = mlir::dyn_cast<xilinx::equeue::MemWriteOp>(op)) {
-    int dlines = getMemVolume( Op.getBuffer() );
-    auto key = valueIds[getAllocOp(Op.getBuffer()).getMemHandler()];
-    auto mem = static_cast<xilinx::equeue::Memory *>(deviceMap[key].get());
+    int dlines = Op.hasOffset() ? 1 : getMemVolume( Op.getBuffer() );
+    auto mem = getMemory(Op.getBuffer());
     c.mem_tids.push_back(mem->uid);
-    execution_time = mem->getReadOrWriteCycles(dlines, xilinx::equeue::MemOp::Write);
-    return mem->scheduleEvent(time, execution_time, true);
+    touch(mem);
+    auto region = getRegion(op, Op.getBuffer(), getOffset(op, Op.getBuffer(), Op.getIndex()),
+      Op.getSize(dlines), Op.getStride());
+    uint64_t end_time = mem->scheduleRegion(time, region, xilinx::equeue::MemOp::Write);
+    trackOverlap(mem, Op.getBuffer(), region, true, time, end_time);
+    return end_time;
   }
   else if (auto Op = mlir::dyn_cast<xilinx::equeue::MemCopyOp>(op)) {
-    //TODO: calculate offset
     int srcLines = getMemVolume( Op.getSrcBuffer() );
     int destLines = getMemVolume( Op.getDestBuffer() );
-    int dlines = std::min(srcLines, destLines);
-    auto srcKey = valueIds[getAllocOp(Op.getSrcBuffer()).getMemHandler()];
-    auto destKey = valueIds[getAllocOp(Op.getDestBuffer()).getMemHandler()];
-    auto srcMem = static_cast<xilinx::equeue::Memory *>(deviceMap[srcKey].get());
+    int dlines = Op.getSize(std::min(srcLines, destLines));
+    // offset and stride walk the larger buffer, the smaller one is
+    // copied from or to as a whole
+    bool srcWindow = srcLines >= destLines;
+    // the host may have moved on since the DMA accepted the copy
+    uint64_t offset = 0;
+    if ( !c.values.empty() && c.values[0] )
+      offset = c.values[0]->i;
+    else if ( Op.offset() )
+      offset = interp.getInt(Op.offset(), op);
+    auto src = getRegion(op, Op.getSrcBuffer(), srcWindow ? offset : 0, dlines,
+      srcWindow ? Op.getStride() : 1);
+    auto dest = getRegion(op, Op.getDestBuffer(), srcWindow ? 0 : offset, dlines,
+      srcWindow ? 1 : Op.getStride());
+    auto &window = srcWindow ? src : dest;
+    auto srcMem = getMemory(Op.getSrcBuffer());
     c.mem_tids.push_back(srcMem->uid);
-    uint64_t readTime = srcMem->getReadOrWriteCycles(dlines, xilinx::equeue::MemOp::Read);
-    auto destMem = static_cast<xilinx::equeue::Memory *>(deviceMap[destKey].get());
+    uint64_t readTime = srcMem->getReadOrWriteCycles(src, xilinx::equeue::MemOp::Read);
+    auto destMem = getMemory(Op.getDestBuffer());
     c.mem_tids.push_back(destMem->uid);
-    uint64_t writeTime = destMem->getReadOrWriteCycles(dlines, xilinx::equeue::MemOp::Write);
+    uint64_t writeTime = destMem->getReadOrWriteCycles(dest, xilinx::equeue::MemOp::Write);
     int total_size = srcMem->total_size;
     int volume = dlines * total_size;
     auto key = valueIds[Op.getDMAHandler()];
     auto dma = static_cast<xilinx::equeue::DMA *>(deviceMap[key].get());
-    uint64_t dmaTime = dma->getTransferCycles(volume);
+    touch(srcMem);
+    touch(destMem);
+    touch(dma);
+    uint64_t dmaTime = dma->getTransferCycles(volume, window.runs.size());
     execution_time = std::max({readTime, writeTime, dmaTime});
-    //clean outdated events
-    return dma->scheduleEvent(time, execution_time, {destMem, srcMem});
+    trackOverlap(srcMem, Op.getSrcBuffer(), src, false, time);
+    uint64_t end_time = dma->scheduleTransfer(time, execution_time, srcMem, src, destMem, dest);
+    trackOverlap(destMem, Op.getDestBuffer(), dest, true, time, end_time);
+    return end_time;
   }
   if (  op->hasTrait<mlir::OpTrait::StructureOpTrait>() ||
         mlir::dyn_cast<mlir::ConstantOp>(op) ||
+        mlir::dyn_cast<xilinx::equeue::SplitContainerOp>(op) ||
+        mlir::dyn_cast<xilinx::equeue::ConcatContainerOp>(op) ||
         mlir::dyn_cast<xilinx::equeue::AwaitOp>(op) ||
+        mlir::dyn_cast<xilinx::equeue::GetCompOp>(op) ||
         mlir::dyn_cast<xilinx::equeue::LaunchOp>(op) ||
         mlir::dyn_cast<xilinx::equeue::ReturnOp>(op) ||
         mlir::dyn_cast<mlir::scf::ForOp>(op) ||
@@ -225,75 +499,204 @@ void updateIterState(mlir::ValueRange args, bool yield){
     }
   }
 }
+void emitOpTrace(OpEntry &c, std::string ph, uint64_t time, uint64_t pid)
+{
+  auto op_str = to_string(c)+std::to_string(c.tid);
+  size_t position = op_str.find(op_str);
+  auto opStr = op_str.substr(position);
+  if ( c.end_time != c.start_time ){
+    if ( c.slot < 0 )
+      emitTraceEvent(traceStream, opStr, "operation", ph, time, pid, 0);
+    else
+      emitTraceEvent(traceStream, opStr, "pipeline", ph, time, pid, TRACE_PID_PIPELINE + c.slot);
+  }
+  for(auto iter = c.mem_tids.begin(); iter != c.mem_tids.end(); iter++){
+    emitTraceEvent(traceStream, opStr, "memory", ph, time, *iter, TRACE_PID_ALLOC);
+  }
+}
+
+void retireOp(OpEntry &c, uint64_t time, uint64_t pid)
+{
+  if (verbose) {
+    llvm::outs() << "finish: '";
+    //c.op->print(llvm::outs());
+    llvm::outs()<<to_string(c.op);
+    llvm::outs() << "' @ " << time << "\n";
+  }
+  progress++;
+
+  LLVM_DEBUG(llvm::dbgs() << "OP:  " << c.op->getName() << "\n");
+  if (auto Op = mlir::dyn_cast<xilinx::equeue::MemCopyOp>(c.op)){
+    updateExecution( c.op->getResults() );
+  }
+  if (auto Op = mlir::dyn_cast<xilinx::equeue::LaunchOp>(c.op)){
+    updateSignalIds( Op.getBody()->getArguments(), Op.getLaunchOperands() );
+  }else if (auto Op = mlir::dyn_cast<xilinx::equeue::ReturnOp>(c.op)) {
+    // increment launchOp && its results
+    updateExecution( c.op->getParentOp()->getResult(0) );
+    updateSignalIds( c.op->getParentOp()->getResults().drop_front(), c.op->getOperands() );
+  }
+  else if (auto Op = mlir::dyn_cast<mlir::scf::ForOp>(c.op)){
+    updateSignalIds( Op.getRegionIterArgs(), Op.getIterOperands() );
+    updateIterState( Op.getRegionIterArgs(), false );
+    // a loop without iterations passes its initial values through
+    if ( !getExTimes(c.op) )
+      updateSignalIds( Op.getResults(), Op.getIterOperands() );
+  }
+  else if (auto Op = mlir::dyn_cast<mlir::scf::YieldOp>(c.op)){
+    if( exTimes[c.op] % getExTimes( c.op->getParentOp() ) == 0 ){
+      updateSignalIds( c.op->getParentOp()->getResults(), c.op->getOperands() );
+    }else{
+      auto pop = mlir::dyn_cast<mlir::scf::ForOp>(c.op->getParentOp());
+      updateSignalIds( pop.getRegionIterArgs(), c.op->getOperands() );
+      updateIterState( pop.getRegionIterArgs(), true );
+    }
+  } else if ( auto Op = mlir::dyn_cast<xilinx::equeue::CreateProcOp>(c.op) ){
+    LauncherTable l;
+    l.name = Op.getAttrOfType<StringAttr>("type").getValue().str() + "_" +
+             std::to_string(launchTables.size());
+    l.event_queue.set_capacity(Op.getQueueDepth());
+    l.issue_width = std::max(Op.getIssueWidth(), 1);
+    l.pipeline_depth = std::max(Op.getPipelineDepth(), 1);
+    l.tick = getTick(c.op);
+    setArbitration(l, Op, c.op->getResult(0));
+    launchTables.insert({c.op->getResult(0), l});
+  } else if ( auto Op = mlir::dyn_cast<xilinx::equeue::CreateDMAOp>(c.op) ){
+    LauncherTable l;
+    l.name = "DMA_" + std::to_string(launchTables.size());
+    l.event_queue.set_capacity(Op.getQueueDepth());
+    // every channel can start a transfer in the same cycle
+    l.issue_width = std::max(Op.getChannels(), 1);
+    l.pipeline_depth = std::max(Op.getChannels(), 1);
+    l.tick = getTick(c.op);
+    setArbitration(l, Op, c.op->getResult(0));
+    launchTables.insert({c.op->getResult(0), l});
+  }
+
+  // emit trace event end
+  emitOpTrace(c, "E", time, pid);
+
+  // if (c.compute_xfer_cost && c.compute_op_cost) {
+  //   if (c.compute_op_cost >= c.compute_xfer_cost) {
+  //     emitTraceEvent(traceStream, "compute_bound", "equeue", "B", c.start_time, 0, TRACE_PID_EQUEUE);
+  //     emitTraceEvent(traceStream, "compute_bound", "equeue", "E", c.end_time, 0, TRACE_PID_EQUEUE);
+  //   }
+  //   else {
+  //     emitTraceEvent(traceStream, "memory_bound", "equeue", "B", c.start_time, 0, TRACE_PID_EQUEUE);
+  //     emitTraceEvent(traceStream, "memory_bound", "equeue", "E", c.end_time, 0, TRACE_PID_EQUEUE);
+  //   }
+  // }
+}
+
+template <class T>
+void setArbitration(LauncherTable &l, T Op, mlir::Value handle)
+{
+  l.id = launcherKeys.size();
+  launcherKeys.push_back(handle);
+  l.arbitration = Op.getArbitration().str();
+  l.priority = std::max(Op.getPriority(), 0);
+  l.weight = std::max(Op.getWeight(), 1);
+}
+
+LauncherTable &getLauncherById(uint64_t id)
+{
+  return id ? launchTables[launcherKeys[id]] : hostTable;
+}
+
+/// true if request a goes before b under the policy of arbiter l
+bool beforeRequest(LauncherTable &l, const ArbiterRequest &a, const ArbiterRequest &b)
+{
+  bool fifo = a.arrival != b.arrival ? a.arrival < b.arrival : a.requester < b.requester;
+  if ( l.arbitration == "round_robin" ){
+    // the requester after the last granted one comes first
+    uint64_t n = launcherKeys.size();
+    uint64_t ra = (a.requester + n - l.last_grant - 1) % n;
+    uint64_t rb = (b.requester + n - l.last_grant - 1) % n;
+    return ra < rb;
+  }
+  if ( l.arbitration == "priority" ){
+    uint64_t pa = getLauncherById(a.requester).priority;
+    uint64_t pb = getLauncherById(b.requester).priority;
+    return pa != pb ? pa > pb : fifo;
+  }
+  if ( l.arbitration == "weighted" ){
+    auto grants = [&](uint64_t id) -> uint64_t {
+      auto it = l.waits.find(id);
+      return it == l.waits.end() ? 0 : it->second.grants;
+    };
+    // least service relative to the weight, grants_a/weight_a < grants_b/weight_b
+    uint64_t sa = grants(a.requester) * getLauncherById(b.requester).weight;
+    uint64_t sb = grants(b.requester) * getLauncherById(a.requester).weight;
+    return sa != sb ? sa < sb : fifo;
+  }
+  return fifo;
+}
+
+/// operands of a launch or memcpy the device reads when it starts the op
+Snapshot captureOperands(mlir::Operation *op)
+{
+  if ( auto Op = llvm::dyn_cast<xilinx::equeue::LaunchOp>(op) )
+    return interp.capture(Op.getLaunchOperands());
+  auto Op = llvm::cast<xilinx::equeue::MemCopyOp>(op);
+  if ( Op.offset() )
+    return interp.capture(Op.offset());
+  return Snapshot();
+}
+
+/// move requests of other launchers into the event queue of l while it has
+/// room, in the order of its arbitration policy; returns true on any grant
+bool arbitrate(LauncherTable &l)
+{
+  bool granted = false;
+  while ( !l.requests.empty() && !l.event_queue.full() ){
+    auto best = l.requests.begin();
+    for ( auto it = l.requests.begin(); it != l.requests.end(); it++ )
+      if ( beforeRequest(l, *it, *best) ) best = it;
+    ArbiterRequest r = *best;
+    l.requests.erase(best);
+    // the requester waits for the grant, its values are those at issue
+    l.add_event_queue(r.op, captureOperands(r.op));
+    l.last_grant = r.requester;
+    auto &stats = l.waits[r.requester];
+    stats.grants++;
+    stats.total_wait += time - r.arrival;
+    stats.max_wait = std::max(stats.max_wait, time - r.arrival);
+
+    auto &requester = getLauncherById(r.requester);
+    requester.requesting = false;
+    requester.unblock(time);
+    requester.advance();
+    progress++;
+    granted = true;
+  }
+  // the rest wait for room in the event queue
+  for ( auto &r : l.requests )
+    getLauncherById(r.requester).block_on_full(time);
+  return granted;
+}
+
 void finishOp(LauncherTable &l, uint64_t time, uint64_t pid)
 {
-  if (l.is_idle()) return;
+  // retire overlapping ops whose results are ready, in any order
+  for (auto it = l.in_flight.begin(); it != l.in_flight.end(); ){
+    if ( it->is_done(time) ){
+      l.busy += it->end_time - it->start_time;
+      retireOp(*it, time, pid);
+      for (Value res : it->op->getResults())
+        l.scoreboard.erase(res);
+      it = l.in_flight.erase(it);
+    } else
+      it++;
+  }
+
+  if (!l.op_entry.op) return;
   LLVM_DEBUG(llvm::dbgs()<<to_string(l.op_entry.op)<<": not idle\n");
 
   auto &c = l.op_entry;
   if (c.is_started()) {
     if (c.is_done(time)) {
-      if (verbose) {
-        llvm::outs() << "finish: '";
-        //c.op->print(llvm::outs());
-        llvm::outs()<<to_string(c.op);
-        llvm::outs() << "' @ " << time << "\n";
-      }
-
-      LLVM_DEBUG(llvm::dbgs() << "OP:  " << c.op->getName() << "\n");
-      if (auto Op = mlir::dyn_cast<xilinx::equeue::MemCopyOp>(c.op)){
-        updateExecution( c.op->getResults() );
-      }
-      if (auto Op = mlir::dyn_cast<xilinx::equeue::LaunchOp>(c.op)){
-        updateSignalIds( Op.getBody()->getArguments(), Op.getLaunchOperands() );
-      }else if (auto Op = mlir::dyn_cast<xilinx::equeue::ReturnOp>(c.op)) {
-        // increment launchOp && its results
-        updateExecution( c.op->getParentOp()->getResult(0) );
-        updateSignalIds( c.op->getParentOp()->getResults().drop_front(), c.op->getOperands() );
-      }
-      else if (auto Op = mlir::dyn_cast<mlir::scf::ForOp>(c.op)){
-        updateSignalIds( Op.getRegionIterArgs(), Op.getIterOperands() );
-        updateIterState( Op.getRegionIterArgs(), false );
-      }
-      else if (auto Op = mlir::dyn_cast<mlir::scf::YieldOp>(c.op)){
-        if( exTimes[c.op] % getExTimes( c.op->getParentOp() ) == 0 ){
-          updateSignalIds( c.op->getParentOp()->getResults(), c.op->getOperands() );
-        }else{
-          auto pop = mlir::dyn_cast<mlir::scf::ForOp>(c.op->getParentOp());
-          updateSignalIds( pop.getRegionIterArgs(), c.op->getOperands() );
-          updateIterState( pop.getRegionIterArgs(), true );
-        }
-      } else{
-        if ( mlir::dyn_cast<xilinx::equeue::CreateProcOp>(c.op) ||
-          mlir::dyn_cast<xilinx::equeue::CreateDMAOp>(c.op)){
-          auto key = c.op->getResult(0);
-          LauncherTable l;
-          launchTables.insert({key, l});
-        }
-      }
-
-      auto op_str = to_string(c)+std::to_string(c.tid);
-      size_t position = op_str.find(op_str);
-      auto opStr = op_str.substr(position);
-      // emit trace event end
-      if ( c.end_time != c.start_time ){
-        emitTraceEvent(traceStream, opStr, "operation", "E", time, pid, 0);
-      }
-      for(auto iter = c.mem_tids.begin(); iter != c.mem_tids.end(); iter++){
-        emitTraceEvent(traceStream, opStr, "memory", "E", time, *iter, 1);
-      }
-
-      // if (c.compute_xfer_cost && c.compute_op_cost) {
-      //   if (c.compute_op_cost >= c.compute_xfer_cost) {
-      //     emitTraceEvent(traceStream, "compute_bound", "equeue", "B", c.start_time, 0, TRACE_PID_EQUEUE);
-      //     emitTraceEvent(traceStream, "compute_bound", "equeue", "E", c.end_time, 0, TRACE_PID_EQUEUE);
-      //   }
-      //   else {
-      //     emitTraceEvent(traceStream, "memory_bound", "equeue", "B", c.start_time, 0, TRACE_PID_EQUEUE);
-      //     emitTraceEvent(traceStream, "memory_bound", "equeue", "E", c.end_time, 0, TRACE_PID_EQUEUE);
-      //   }
-      // }
-
+      l.busy += c.end_time - c.start_time;
+      retireOp(c, time, pid);
       // set op_entry to empty
       OpEntry entry;
       l.op_entry = entry;
@@ -311,9 +714,42 @@ void finishOp(LauncherTable &l, uint64_t time, uint64_t pid)
 
 }
 
+/// ops a pipelined launcher may overlap with the ops issued after them,
+/// memcpys overlap on the channels of a DMA
+bool isPipelineable(mlir::Operation *op)
+{
+  if ( mlir::dyn_cast<xilinx::equeue::MemCopyOp>(op) )
+    return true;
+  return !op->hasTrait<mlir::OpTrait::StructureOpTrait>() &&
+         !op->hasTrait<mlir::OpTrait::AsyncOpTrait>() &&
+         !op->hasTrait<mlir::OpTrait::IsTerminator>() &&
+         !op->getNumRegions() &&
+         !mlir::dyn_cast<xilinx::equeue::AwaitOp>(op);
+}
+
+/// check issue width, scoreboard and free lanes of a pipelined launcher
+bool canIssue(LauncherTable &l, mlir::Operation *op, uint64_t time)
+{
+  if ( time >= l.issue_cycle + l.tick ){
+    l.issue_cycle = time;
+    l.issued = 0;
+  }
+  if ( l.issued >= l.issue_width ) return false;
+  // read after write: wait for in-flight producers
+  for ( Value in : op->getOperands() )
+    if ( l.scoreboard.count(in) ) return false;
+  if ( isPipelineable(op) )
+    return l.in_flight.size() < l.pipeline_depth;
+  // leaving the launch body drains the pipeline
+  if ( mlir::dyn_cast<xilinx::equeue::ReturnOp>(op) ||
+       mlir::dyn_cast<mlir::ReturnOp>(op) )
+    return l.in_flight.empty();
+  return true;
+}
+
 void scheduleOp(LauncherTable &l, uint64_t time, uint64_t pid)
 {
-  if( l.is_idle() ) return;
+  if( !l.op_entry.op ) return;
 
   auto& c_next = l.op_entry;
   LLVM_DEBUG(llvm::dbgs()<<"[schedule] got c_next\n");
@@ -327,14 +763,24 @@ void scheduleOp(LauncherTable &l, uint64_t time, uint64_t pid)
   LLVM_DEBUG(llvm::dbgs()<<"[schedule] not waiting for any signal\n");
 
   if ( !c_next.is_started() ){
+    if ( l.is_pipelined() && !canIssue(l, c_next.op, time) )
+      return;
     if( llvm::dyn_cast<xilinx::equeue::LaunchOp>(c_next.op) ||
         llvm::dyn_cast<xilinx::equeue::MemCopyOp>(c_next.op) ||
          llvm::dyn_cast<xilinx::equeue::AwaitOp>(c_next.op) ){
       opMap[c_next.op]++;
     }
     LLVM_DEBUG(llvm::dbgs()<<"[schedule] updated execution\n");
+    progress++;
     c_next.start_time = time;
-    c_next.end_time = modelOp(time, c_next);
+    c_next.end_time = modelOp(time, c_next, l.tick);
+
+    bool overlap = l.is_pipelined() && isPipelineable(c_next.op) &&
+                   c_next.end_time != c_next.start_time;
+    if ( l.is_pipelined() && c_next.end_time != c_next.start_time )
+      l.issued++;
+    if ( overlap )
+      c_next.slot = l.free_slot();
 
     if (verbose) {
       llvm::outs()<<"scheduled: '";
@@ -342,37 +788,43 @@ void scheduleOp(LauncherTable &l, uint64_t time, uint64_t pid)
       llvm::outs()<<to_string(c_next.op);
       llvm::outs() << "' @ " << c_next.start_time << " - " << c_next.end_time << "\n";
     }
-    auto op_str = to_string(c_next)+std::to_string(c_next.tid);
-    size_t position = op_str.find(op_str);
-    auto opStr = op_str.substr(position);
-    if ( c_next.end_time != c_next.start_time ){
-      emitTraceEvent(traceStream, opStr, "operation", "B", time, pid, 0);
-    }
-    for(auto iter = c_next.mem_tids.begin(); iter != c_next.mem_tids.end(); iter++){
-      emitTraceEvent(traceStream, opStr, "memory", "B", time, *iter, 1);
-    }
+    emitOpTrace(c_next, "B", time, pid);
     if (time > c_next.queue_ready_time) {
       emitTraceEvent(traceStream, "stall", "operation", "B", c_next.queue_ready_time, pid, 0);
       emitTraceEvent(traceStream, "stall", "operation", "E", time, pid, 0);
     }
 
+    if ( overlap ){
+      // free the issue slot, the results are tracked by the scoreboard
+      for (Value res : c_next.op->getResults())
+        l.scoreboard[res] = c_next.end_time;
+      l.in_flight.push_back(c_next);
+      OpEntry entry;
+      l.op_entry = entry;
+    }
   }
   return;
 }
 
-
-int64_t getConstant(mlir::Value v){
-  if (auto constantOp = v.getDefiningOp<ConstantOp>())
-    return constantOp.getValue().cast<IntegerAttr>().getInt();
-  else
-    llvm_unreachable("invalid for loop control argument");
+/// schedule the op_entry; a pipelined launcher keeps fetching and issuing
+/// ops in the same cycle while they go to a pipeline lane
+void issueOps(LauncherTable &l, uint64_t time, uint64_t pid, uint64_t &tid)
+{
+  scheduleOp(l, time, pid);
+  while ( l.is_pipelined() && !l.op_entry.op ){
+    setOpEntry(l, tid, pid);
+    // a DMA takes the next transfer from its queue
+    if ( !l.op_entry.op ) checkEventQueue(l, pid);
+    if ( !l.op_entry.op ) break;
+    scheduleOp(l, time, pid);
+  }
 }
-/// get execution time of for loop, assuming all bounds are constant
+
+/// get execution time of for loop with the bounds the interpreter has
+/// computed so far, they may depend on values produced at run time
 int64_t getExTimes(mlir::Operation *op){
-  int64_t lb = getConstant(op->getOperand(0));
-  int64_t ub = getConstant(op->getOperand(1));
-  int64_t step =  getConstant(op->getOperand(2));
-  return int((ub - lb)/step);
+  auto trip = interp.getTripCount(mlir::cast<mlir::scf::ForOp>(op));
+  return trip ? *trip : 0;
 }
 
 mlir::Value getSignalId(mlir::Value in){
@@ -425,9 +877,47 @@ bool waitForSignal(mlir::Operation* op, mlir::Value in){
   return false;
 }
 
-void checkEventQueue(LauncherTable& l){
+/// ops modelOp gives no execution time and that wait for nothing
+bool isZeroLatency(LauncherTable &l, mlir::Operation *op)
+{
+  // devices may only be created while launchTables is not iterated
+  if ( op->hasTrait<mlir::OpTrait::StructureOpTrait>() )
+    return &l == &hostTable;
+  // an await on done signals enters no queue and waits for nothing
+  if ( mlir::isa<xilinx::equeue::AwaitOp>(op) )
+    return !waitForSignal(op);
+  return mlir::isa<mlir::ConstantOp>(op) ||
+         mlir::isa<xilinx::equeue::SplitContainerOp>(op) ||
+         mlir::isa<xilinx::equeue::ConcatContainerOp>(op) ||
+         mlir::isa<xilinx::equeue::GetCompOp>(op) ||
+         mlir::isa<xilinx::equeue::LaunchOp>(op) ||
+         mlir::isa<xilinx::equeue::ReturnOp>(op) ||
+         mlir::isa<mlir::scf::ForOp>(op) ||
+         mlir::isa<mlir::scf::YieldOp>(op) ||
+         mlir::isa<mlir::ReturnOp>(op);
+}
+/// schedule and retire the op_entry of l within the current step instead
+/// of spending a step of the event loop on it; false if it has to wait
+bool retireNow(LauncherTable &l, uint64_t pid)
+{
+  auto &c = l.op_entry;
+  if ( !isZeroLatency(l, c.op) || (l.is_pipelined() && !canIssue(l, c.op, time)) )
+    return false;
+  if ( mlir::isa<xilinx::equeue::LaunchOp>(c.op) ||
+       mlir::isa<xilinx::equeue::AwaitOp>(c.op) )
+    opMap[c.op]++;
+  progress++;
+  c.queue_ready_time = time;
+  c.start_time = time;
+  c.end_time = modelOp(time, c, l.tick);
+  retireOp(c, time, pid);
+  l.op_entry = OpEntry();
+  return true;
+}
+
+void checkEventQueue(LauncherTable& l, uint64_t pid){
   while( !l.event_queue.empty() ){
-    auto op = l.event_queue.front();
+    auto op = l.event_queue.front().op;
 
     if(op->hasTrait<mlir::OpTrait::ControlOpTrait>()){
       if( waitForSignal(op) ) return;
@@ -436,7 +926,8 @@ void checkEventQueue(LauncherTable& l){
       updateExecution(op->getResults());
       // first event of event_queue will be handled by launcher
       // continue to check next one
-      l.event_queue.erase(l.event_queue.begin());
+      l.event_queue.pop_front();
+      progress++;
       continue;
     }
     //mlir::Value launcher;
@@ -449,40 +940,53 @@ void checkEventQueue(LauncherTable& l){
       //launcher = valueIds[Op.getDMAHandler()];
     }
 
-    if( l.is_idle() ){
+    // a launch takes over the launcher, a memcpy only needs the issue slot
+    // while earlier transfers are still running on other channels
+    bool ready = llvm::dyn_cast<xilinx::equeue::LaunchOp>(op) ? l.is_idle() : !l.op_entry.op;
+    if( ready ){
       // the first event of event_queue is ready at launcher
       // and launcher is idle to process it
 
       // the only way to get launchOp is through checkEventQueue
       // so we need to update next_iter and op_entry here
       OpEntry entry(op);
+      entry.values = l.event_queue.front().values;
       l.op_entry = entry;
       LLVM_DEBUG(llvm::dbgs()<<"[launchee] added op_entry\n");
-      if( auto Op = llvm::dyn_cast<xilinx::equeue::LaunchOp>(op) )
+      if( auto Op = llvm::dyn_cast<xilinx::equeue::LaunchOp>(op) ){
         l.set_block(Op.getBody());
-      l.event_queue.erase(l.event_queue.begin());
+        interp.bind(Op.getBody()->getArguments(), entry.values);
+      }
+      l.event_queue.pop_front();
+      progress++;
       LLVM_DEBUG(llvm::dbgs()<<"[launchee] erased : "<<l.event_queue.size()<<"\n");
+      retireNow(l, pid);
     }
     break;
   }
 }
 
-void setOpEntry(LauncherTable& l, uint64_t& tid){
+void setOpEntry(LauncherTable& l, uint64_t& tid, uint64_t pid){
     auto &opEntry = l.op_entry;
     if(!opEntry.op){
       while(true){
-        if( !l.block || l.next_iter == l.block->end() ) break;
+        auto op = l.next_op();
+        if( !op ) break;
+        if ( checkpointInterval )
+          firstFetch.insert({op, step});
         LLVM_DEBUG(llvm::dbgs()<<"[set_op_entry] next op\n");
-        auto op = &*l.next_iter;
         LLVM_DEBUG(llvm::dbgs()<<to_string(op)<<"\n");
-        LauncherTable lt;
         if(op->hasTrait<mlir::OpTrait::AsyncOpTrait>()){
           // launch, memcpy, control...
           if(op->hasTrait<mlir::OpTrait::ControlOpTrait>()){
             if (l.add_event_queue(op)){
-              l.next_iter++;
-            }else
+              l.unblock(time);
+              l.advance();
+              progress++;
+            }else{
+              l.block_on_full(time);
               break;
+            }
           }else{
             Value launcher;
             if( auto Op = llvm::dyn_cast<xilinx::equeue::LaunchOp>(op) ){
@@ -491,32 +995,48 @@ void setOpEntry(LauncherTable& l, uint64_t& tid){
             } else if ( auto Op = llvm::dyn_cast<xilinx::equeue::MemCopyOp>(op) ){
               launcher = valueIds[Op.getDMAHandler()];
             }
+            // the launcher moves on once the arbiter of lt grants the
+            // request, see arbitrate
             auto& lt = launchTables[launcher];
-            if(lt.add_event_queue(op)){
-              l.next_iter++;
-            }else
-              break;
+            if ( !l.requesting ){
+              lt.requests.push_back({l.id, op, time});
+              l.requesting = true;
+            }
+            break;
           }
         } else {
           OpEntry entry(op, tid++);
           l.op_entry=entry;
+          progress++;
+          // values are computed in issue order, modelOp gives the time
+          interp.execute(op);
           if (auto Op = mlir::dyn_cast<mlir::scf::ForOp>(op)){
-            l.set_block(Op.getBody());
+            // the bounds are evaluated once per entry of the loop
+            exTimes[Op.getBody()->getTerminator()] = 0;
+            interp.enterLoop(Op);
+            if (getExTimes(op))
+              l.set_block(Op.getBody());
+            else
+              l.advance();
           } else if ( auto Op = llvm::dyn_cast<mlir::scf::YieldOp>(op) ){
             exTimes[op]++;
             LLVM_DEBUG(llvm::dbgs()<<"[set_op_entry] forOp ex times: "<<exTimes[op]<<"\n");
-            auto pop = op->getParentOp(); // forOp
+            auto pop = llvm::dyn_cast<mlir::scf::ForOp>(op->getParentOp());
             if (exTimes[op] % getExTimes(pop) == 0) {
               // exit for loop
-              l.block = pop->getBlock();
-              l.next_iter = ++mlir::Block::iterator(pop);
+              interp.exitLoop(pop);
+              l.block = pop.getOperation()->getBlock();
+              l.next_iter = ++mlir::Block::iterator(pop.getOperation());
             }else{
               // redo for loop
-              l.next_iter =  llvm::dyn_cast<mlir::scf::ForOp>(pop).getBody()->begin();
+              interp.nextIteration(pop);
+              l.next_iter = pop.getBody()->begin();
             }
           } else {
-            l.next_iter++;
+            l.advance();
           }
+          // fetch on after constants, loop control, returns...
+          if (retireNow(l, pid)) continue;
           break;
         }
       }
@@ -524,9 +1044,15 @@ void setOpEntry(LauncherTable& l, uint64_t& tid){
 }
 
 void nextEndTimes( LauncherTable &l, std::vector<uint64_t> &next_times){
-  if ( !l.is_idle() && l.op_entry.is_started() ){
+  if ( l.op_entry.op && l.op_entry.is_started() ){
   	next_times.push_back(l.op_entry.end_time);
   }
+  for ( auto &c : l.in_flight )
+    next_times.push_back(c.end_time);
+  // the op held back by the issue width goes in the next cycle
+  if ( l.op_entry.op && !l.op_entry.is_started() && l.is_pipelined() &&
+       l.issued >= l.issue_width )
+    next_times.push_back(l.issue_cycle + l.tick);
 }
 
 void simulateFunction(mlir::FuncOp &toplevel)
@@ -537,32 +1063,55 @@ void simulateFunction(mlir::FuncOp &toplevel)
   hostTable.block = &toplevel.getCallableRegion()->front();
 
   time = 1;
+  // e.g. a get_comp of an unknown name
+  if (failed) return;
+  continueSimulation(toplevel);
+}
+
+/// the event loop, from the start or from a checkpoint
+void continueSimulation(mlir::FuncOp &toplevel)
+{
   bool running = true;
-  uint64_t tid = 0;
+  uint64_t &tid = nextTid;
+  uint64_t steps_at_time = 0;
   while (running) {
+    if ( checkpointInterval && step % checkpointInterval == 0 )
+      takeCheckpoint();
+    step++;
+    uint64_t step_time = time;
+    uint64_t step_progress = progress;
     LLVM_DEBUG(llvm::dbgs()<<"1. setOpEntry\n");
-    setOpEntry(hostTable, tid);
-    for ( auto iter = launchTables.begin(); iter != launchTables.end(); iter++){
-      LLVM_DEBUG(llvm::dbgs()<<iter->first<<":\n");
-      setOpEntry(iter->second, tid);
+    // a launcher granted by an arbiter fetches further ops in the same cycle
+    bool granted = true;
+    while (granted) {
+      uint64_t pid = 0;
+      setOpEntry(hostTable, tid, pid++);
+      for ( auto iter = launchTables.begin(); iter != launchTables.end(); iter++){
+        LLVM_DEBUG(llvm::dbgs()<<iter->first<<":\n");
+        setOpEntry(iter->second, tid, pid++);
+      }
+      granted = false;
+      for ( auto iter = launchTables.begin(); iter != launchTables.end(); iter++)
+        granted = arbitrate(iter->second) || granted;
     }
 
     LLVM_DEBUG(llvm::dbgs()<<"2. checkEventQueue\n");
-    checkEventQueue(hostTable);
+    uint64_t pid = 0;
+    checkEventQueue(hostTable, pid++);
     for ( auto iter = launchTables.begin(); iter != launchTables.end(); iter++){
-      checkEventQueue(iter->second);
+      checkEventQueue(iter->second, pid++);
     }
     // end condition, nothing can be put on to op_entry
-    running = !hostTable.is_idle();
+    running = !hostTable.is_finished();
 		for (auto iter = launchTables.begin(); iter!=launchTables.end(); iter++)
-			running = running || !iter->second.is_idle();
+			running = running || !iter->second.is_finished();
     if( !running ) break;
 
     LLVM_DEBUG(llvm::dbgs()<<"3. scheduleOp\n");
-    uint64_t pid = 0;
-    scheduleOp(hostTable, time, pid++);
+    pid = 0;
+    issueOps(hostTable, time, pid++, tid);
     for (auto iter = launchTables.begin(); iter!= launchTables.end(); iter++){
-			scheduleOp(iter->second, time, pid++);
+			issueOps(iter->second, time, pid++, tid);
 		}
 
     // find the closest time stamp currently running op is done.
@@ -583,10 +1132,401 @@ void simulateFunction(mlir::FuncOp &toplevel)
     for (auto iter = launchTables.begin(); iter!= launchTables.end(); iter++){
 			finishOp(iter->second, time, pid++);
 		}
+
+    // watchdog: the simulation is deterministic, a step that changes
+    // neither time nor any state repeats forever
+    if ( time == step_time && progress == step_progress ){
+      reportStall(toplevel, false);
+      break;
+    }
+    steps_at_time = time == step_time ? steps_at_time + 1 : 0;
+    if ( steps_at_time >= WATCHDOG_STEPS ){
+      reportStall(toplevel, true);
+      break;
+    }
     LLVM_DEBUG(llvm::dbgs()<<"=================\n\n");
   }
 
 }
+
+/// keep the state before the next step, at most MAX_CHECKPOINTS of them
+void takeCheckpoint()
+{
+  checkpoints.push_back({step, checkpoint()});
+  if ( checkpoints.size() <= MAX_CHECKPOINTS ) return;
+  // thin out to every other checkpoint, and take them half as often
+  for ( unsigned i = 1; i < checkpoints.size(); i++ )
+    checkpoints.erase(checkpoints.begin() + i);
+  checkpointInterval *= 2;
+}
+
+/// copy of the whole simulation state, devices are cloned
+std::shared_ptr<Runner> checkpoint() const
+{
+  auto r = std::make_shared<Runner>(*this);
+  // a resumed run has no trace before the checkpoint, it writes none
+  r->tracing = false;
+  r->checkpoints.clear();
+  r->checkpointInterval = 0;
+  r->program.clear();
+  r->firstFetch.clear();
+  // point to the cloned devices
+  llvm::DenseMap<xilinx::equeue::Device *, xilinx::equeue::Device *> to;
+  for ( auto &d : deviceMap )
+    to[d.second.get()] = r->deviceMap[d.first].get();
+  auto memory = [&](xilinx::equeue::Memory *m){
+    return static_cast<xilinx::equeue::Memory *>(to.lookup(m));
+  };
+  for ( auto &m : r->memories ) m = memory(m);
+  for ( auto &d : r->drams ) d = static_cast<xilinx::equeue::DRAM *>(to.lookup(d));
+  for ( auto &c : r->caches ){
+    c = static_cast<xilinx::equeue::Cache *>(to.lookup(c));
+    if ( c->parent ) c->parent = memory(c->parent);
+  }
+  r->memoryNames.clear();
+  for ( auto &n : memoryNames )
+    r->memoryNames[memory(n.first)] = n.second;
+  r->pendingWrites.clear();
+  for ( auto &w : pendingWrites )
+    r->pendingWrites[memory(w.first)] = w.second;
+  return r;
+}
+
+/// recreate a device under the current knobs, only valid before its first use
+void rebuildDevice(mlir::Operation *op)
+{
+  auto key = valueIds[op->getResult(0)];
+  auto old = deviceMap[key].get();
+  uint64_t uid = old->uid;
+  if ( auto Op = mlir::dyn_cast<xilinx::equeue::CreateMemOp>(op) ){
+    auto oldMem = static_cast<xilinx::equeue::Memory *>(old);
+    auto name = memoryNames[oldMem];
+    memoryNames.erase(oldMem);
+    unsigned ndrams = drams.size(), ncaches = caches.size();
+    createMemory(Op, uid, name);
+    auto mem = static_cast<xilinx::equeue::Memory *>(deviceMap[key].get());
+    // keep the creation order of the statistics
+    memories.pop_back();
+    std::replace(memories.begin(), memories.end(), oldMem, mem);
+    if ( drams.size() > ndrams ){
+      drams.pop_back();
+      std::replace(drams.begin(), drams.end(),
+        static_cast<xilinx::equeue::DRAM *>(oldMem), static_cast<xilinx::equeue::DRAM *>(mem));
+    }
+    if ( caches.size() > ncaches ){
+      caches.pop_back();
+      std::replace(caches.begin(), caches.end(),
+        static_cast<xilinx::equeue::Cache *>(oldMem), static_cast<xilinx::equeue::Cache *>(mem));
+    }
+    for ( auto c : caches )
+      if ( c->parent == oldMem ) c->parent = mem;
+  } else if ( auto Op = mlir::dyn_cast<xilinx::equeue::CreateDMAOp>(op) ){
+    auto name = "DMA_" + std::to_string(uid);
+    for ( auto &k : knobDevices )
+      if ( k.second == uid ) name = k.first.substr(0, k.first.find('.'));
+    createDMA(Op, uid, name);
+  }
+}
+
+/// first step an edit of toplevel since recordProgram can matter: the first
+/// fetch of the earliest op with changed attributes, 0 when ops or operands
+/// changed, or attributes the analysis read, a frequency or a component name
+uint64_t firstEdit(mlir::FuncOp &toplevel) const
+{
+  if ( program.empty() ) return UINT64_MAX;
+  uint64_t first = UINT64_MAX;
+  bool reshaped = false;
+  size_t i = 0;
+  toplevel.walk([&](mlir::Operation *op){
+    if ( reshaped ) return;
+    auto operands = op->getOperands();
+    if ( i == program.size() || program[i].op != op ||
+         program[i].name != op->getName() ||
+         operands.size() != program[i].operands.size() ||
+         !std::equal(operands.begin(), operands.end(), program[i].operands.begin()) ){
+      reshaped = true;
+      return;
+    }
+    auto attrs = mlir::Builder(op->getContext()).getDictionaryAttr(op->getAttrs());
+    auto old = program[i++].attrs;
+    if ( attrs == old ) return;
+    if ( attrs.get("frequency") != old.get("frequency") ||
+         mlir::isa<xilinx::equeue::CreateCompOp>(op) ||
+         mlir::isa<xilinx::equeue::GetCompOp>(op) ){
+      reshaped = true;
+      return;
+    }
+    // an op never fetched did not run, its edit matters only from there on
+    auto it = firstFetch.find(op);
+    if ( it != firstFetch.end() ) first = std::min(first, it->second);
+  });
+  return reshaped || i != program.size() ? 0 : first;
+}
+
+/// rerun under perturb and the edits of toplevel from the latest checkpoint
+/// taken before any device with a changed knob was first used and before
+/// the first edited op was fetched, null without such a checkpoint
+std::shared_ptr<Runner> resume(const std::map<std::string, double> &perturb,
+                               mlir::FuncOp &toplevel) const
+{
+  auto factor = [](const std::map<std::string, double> &m, const std::string &k){
+    auto it = m.find(k);
+    return it == m.end() ? 1.0 : it->second;
+  };
+  uint64_t first = firstEdit(toplevel);
+  std::vector<uint64_t> changed;
+  for ( auto &k : knobDevices ){
+    if ( factor(perturb, k.first) == factor(perturbation, k.first) ) continue;
+    changed.push_back(k.second);
+    auto it = firstUse.find(k.second);
+    if ( it != firstUse.end() ) first = std::min(first, it->second);
+  }
+  const Runner *from = nullptr;
+  for ( auto &c : checkpoints )
+    if ( c.first < first ) from = c.second.get();
+  if ( !from ) return nullptr;
+  auto r = from->checkpoint();
+  r->perturbation = perturb;
+  r->resumedAt = r->step;
+  // devices created before the checkpoint still have the old knobs
+  std::sort(changed.begin(), changed.end());
+  changed.erase(std::unique(changed.begin(), changed.end()), changed.end());
+  for ( auto uid : changed )
+    if ( r->deviceOps.count(uid) )
+      r->rebuildDevice(r->deviceOps[uid]);
+  r->continueSimulation(toplevel);
+  return r;
+}
+
+/// launcher that runs an async op, or issues any other op; null if the
+/// device of a launch or memcpy was never created
+LauncherTable *getLauncher(mlir::Operation *op)
+{
+  mlir::Value device;
+  if ( auto Op = llvm::dyn_cast<xilinx::equeue::LaunchOp>(op) )
+    device = valueIds[Op.getDeviceHandler()];
+  else if ( auto Op = llvm::dyn_cast<xilinx::equeue::MemCopyOp>(op) )
+    device = valueIds[Op.getDMAHandler()];
+  else {
+    for ( auto pop = op->getParentOp(); pop; pop = pop->getParentOp() )
+      if ( llvm::isa<xilinx::equeue::LaunchOp>(pop) )
+        return getLauncher(pop);
+    return &hostTable;
+  }
+  auto it = launchTables.find(device);
+  return it == launchTables.end() ? nullptr : &it->second;
+}
+
+/// wait-for graph of a stalled simulation: launchers wait for blocked ops or
+/// full queues, ops for signals, signals for their producer's launcher
+struct WaitNode {
+  std::string name;
+  // location of the note, null for launchers
+  mlir::Operation *op;
+  std::vector<unsigned> waitsFor;
+};
+struct WaitForGraph {
+  std::vector<WaitNode> nodes;
+  std::map<const void *, unsigned> index;
+  unsigned node(const void *key, std::string name, mlir::Operation *op = nullptr){
+    auto it = index.find(key);
+    if ( it != index.end() ) return it->second;
+    index[key] = nodes.size();
+    nodes.push_back({name, op, {}});
+    return nodes.size() - 1;
+  }
+  void edge(unsigned from, unsigned to){
+    auto &w = nodes[from].waitsFor;
+    if ( std::find(w.begin(), w.end(), to) == w.end() ) w.push_back(to);
+  }
+};
+
+unsigned addLauncher(WaitForGraph &g, LauncherTable *l)
+{
+  if ( !l ) return g.node(nullptr, "device that was never created");
+  bool known = g.index.count(l);
+  unsigned n = g.node(l, l->name);
+  if ( known ) return n;
+  // ops the launcher cannot get past
+  std::vector<mlir::Operation *> blocked;
+  if ( l->op_entry.op && !l->op_entry.is_started() )
+    blocked.push_back(l->op_entry.op);
+  if ( !l->event_queue.empty() )
+    blocked.push_back(l->event_queue.front().op);
+  for ( auto op : blocked ){
+    unsigned o = g.node(op, "'" + to_string(op) + "'", op);
+    g.edge(n, o);
+    std::vector<mlir::Value> signals;
+    if ( auto Op = llvm::dyn_cast<xilinx::equeue::LaunchOp>(op) )
+      signals.push_back(Op.getStartSignal());
+    else
+      signals.assign(op->operand_begin(), op->operand_end());
+    for ( auto in : signals )
+      if ( in.getType().isa<xilinx::equeue::EQueueSignalType>() &&
+           waitForSignal(op, in) )
+        g.edge(o, addSignal(g, in));
+  }
+  // an async op stuck in front of a full event queue
+  if ( l->requesting && l->next_op() ){
+    auto op = l->next_op();
+    unsigned o = g.node(op, "'" + to_string(op) + "' (queue full)", op);
+    g.edge(n, o);
+    if ( !op->hasTrait<mlir::OpTrait::ControlOpTrait>() )
+      g.edge(o, addLauncher(g, getLauncher(op)));
+  }
+  // nothing left to run, e.g. the producer of a signal already finished
+  if ( g.nodes[n].waitsFor.empty() && l->is_idle() )
+    g.nodes[n].name += " (idle)";
+  return n;
+}
+
+unsigned addSignal(WaitForGraph &g, mlir::Value in)
+{
+  auto signal = getSignalId(valueIds[in]);
+  auto producer = signal.getDefiningOp();
+  if ( !producer ){
+    auto arg = signal.cast<BlockArgument>();
+    return g.node(signal.getAsOpaquePointer(), "argument #" +
+      std::to_string(arg.getArgNumber()) + " of '" +
+      to_string(arg.getOwner()->getParentOp()) + "' (never produced)",
+      arg.getOwner()->getParentOp());
+  }
+  bool known = g.index.count(signal.getAsOpaquePointer());
+  unsigned n = g.node(signal.getAsOpaquePointer(),
+    "signal of '" + to_string(producer) + "'", producer);
+  if ( !known )
+    g.edge(n, addLauncher(g, getLauncher(producer)));
+  return n;
+}
+
+/// abort a simulation that stopped making progress, report a cycle of the
+/// wait-for graph or the chain that ends at a missing producer
+void reportStall(mlir::FuncOp &toplevel, bool livelock)
+{
+  failed = true;
+  WaitForGraph g;
+  std::vector<LauncherTable *> launchers{&hostTable};
+  for ( auto iter = launchTables.begin(); iter != launchTables.end(); iter++ )
+    launchers.push_back(&iter->second);
+  std::sort(launchers.begin() + 1, launchers.end(),
+    [](LauncherTable *a, LauncherTable *b){ return a->name < b->name; });
+  for ( auto l : launchers )
+    if ( !l->is_idle() || !l->event_queue.empty() || l->requesting )
+      addLauncher(g, l);
+
+  // depth-first search for a cycle, else follow the first chain to its end
+  std::vector<unsigned> path, cycle;
+  std::vector<int> state(g.nodes.size(), 0);
+  std::function<bool(unsigned)> visit = [&](unsigned n){
+    state[n] = 1;
+    path.push_back(n);
+    for ( auto m : g.nodes[n].waitsFor ){
+      if ( state[m] == 1 ){
+        cycle.assign(std::find(path.begin(), path.end(), m), path.end());
+        cycle.push_back(m);
+        return true;
+      }
+      if ( !state[m] && visit(m) ) return true;
+    }
+    path.pop_back();
+    state[n] = 2;
+    return false;
+  };
+  for ( unsigned n = 0; n < g.nodes.size() && cycle.empty(); n++ )
+    if ( !state[n] ) visit(n);
+  if ( cycle.empty() && !g.nodes.empty() ){
+    std::vector<bool> seen(g.nodes.size(), false);
+    for ( unsigned n = 0; !seen[n]; ){
+      seen[n] = true;
+      cycle.push_back(n);
+      if ( g.nodes[n].waitsFor.empty() ) break;
+      n = g.nodes[n].waitsFor.front();
+    }
+  }
+
+  std::string chain;
+  for ( auto n : cycle )
+    chain += (chain.empty() ? "" : " -> ") + g.nodes[n].name;
+  mlir::Operation *at = toplevel.getOperation();
+  for ( auto n : cycle )
+    if ( g.nodes[n].op ){ at = g.nodes[n].op; break; }
+  auto diag = at->emitError(livelock ? "simulation livelocked" : "simulation deadlocked")
+    << " at time " << formatTime(time) << ": " << chain;
+  if ( livelock )
+    diag << " (" << WATCHDOG_STEPS << " steps without time advancing)";
+  for ( auto n : cycle )
+    if ( g.nodes[n].op && g.nodes[n].op != at )
+      diag.attachNote(g.nodes[n].op->getLoc()) << g.nodes[n].name;
+}
+
+void printStatistics(llvm::raw_ostream &os)
+{
+  std::vector<LauncherTable *> launchers;
+  for (auto iter = launchTables.begin(); iter != launchTables.end(); iter++)
+    launchers.push_back(&iter->second);
+  std::sort(launchers.begin(), launchers.end(),
+    [](LauncherTable *a, LauncherTable *b){ return a->name < b->name; });
+  launchers.insert(launchers.begin(), &hostTable);
+
+  os << "simulated time: " << time;
+  if (timeBase) os << " ticks, " << formatTime(time) << " us";
+  os << "\n";
+  os << llvm::format("%-16s %8s %14s %14s\n", "launcher", "queue", "full stalls", "stall cycles");
+  for (auto l : launchers){
+    // a launcher still blocked at the end counts up to now
+    uint64_t cycles = l->full_stall_cycles;
+    if (l->blocked_on_full) cycles += time - l->full_since;
+    os << llvm::format("%-16s %8llu %14llu %14llu\n", l->name.c_str(),
+      (unsigned long long)l->event_queue.capacity(),
+      (unsigned long long)l->full_stalls, (unsigned long long)cycles);
+  }
+  bool arbitrated = false;
+  for (auto l : launchers)
+    arbitrated = arbitrated || l->waits.size() > 1;
+  if (arbitrated)
+    os << llvm::format("%-16s %-16s %12s %8s %10s %10s\n", "arbiter", "requester",
+      "policy", "grants", "avg wait", "max wait");
+  for (auto l : launchers){
+    if (l->waits.size() < 2) continue;
+    for (auto &w : l->waits)
+      os << llvm::format("%-16s %-16s %12s %8llu %10.1f %10llu\n", l->name.c_str(),
+        getLauncherById(w.first).name.c_str(), l->arbitration.c_str(),
+        (unsigned long long)w.second.grants,
+        double(w.second.total_wait) / w.second.grants,
+        (unsigned long long)w.second.max_wait);
+  }
+  os << llvm::format("%-16s %10s %10s %10s %10s %14s\n", "memory", "allocator",
+    "capacity", "peak", "in use", "fragmentation");
+  for (auto mem : memories){
+    auto &a = mem->allocator;
+    const char *policy = a.policy == xilinx::equeue::AllocPolicy::Bump ? "bump" :
+      a.policy == xilinx::equeue::AllocPolicy::Buddy ? "buddy" : "freelist";
+    os << llvm::format("%-16s %10s %10llu %10llu %10llu %13.1f%%\n", memoryNames[mem].c_str(),
+      policy, (unsigned long long)a.capacity, (unsigned long long)a.peak,
+      (unsigned long long)a.used, 100 * a.max_fragmentation);
+  }
+  if (hasViews)
+    os << "overlapping view accesses: " << overlapConflicts << "\n";
+  if (!caches.empty())
+    os << llvm::format("%-16s %10s %10s %11s %9s\n", "cache", "hits", "misses",
+      "writebacks", "hit rate");
+  for (auto c : caches){
+    os << llvm::format("%-16s %10llu %10llu %11llu %8.1f%%\n",
+      memoryNames[c].c_str(), (unsigned long long)c->hits,
+      (unsigned long long)c->misses, (unsigned long long)c->writebacks,
+      100 * c->hitRate());
+  }
+  if (drams.empty()) return;
+  os << llvm::format("%-16s %8s %8s %10s %10s %9s %14s\n", "dram", "hits", "misses",
+    "conflicts", "refreshes", "hit rate", "bytes/cycle");
+  for (auto d : drams){
+    os << llvm::format("%-16s %8llu %8llu %10llu %10llu %8.1f%% %14.2f\n",
+      memoryNames[d].c_str(), (unsigned long long)d->row_hits,
+      (unsigned long long)d->row_misses, (unsigned long long)d->row_conflicts,
+      (unsigned long long)d->refreshes, 100 * d->rowHitRate(), d->bandwidth());
+  }
+}
+
 template <typename FuncT>
 void walkRegions(MutableArrayRef<Region> regions, const FuncT &func) {
   for (Region &region : regions)
@@ -610,8 +1550,12 @@ void walkRegions(MutableArrayRef<Region> regions, const FuncT &func) {
   };
 
 /// link operands of launch with region arguments of launch region
-/// so that a region argument is mapped to its defining Op
+/// so that a region argument is mapped to its defining Op; a get_comp is
+/// mapped to the sub-component it names
 void buildIdMap(mlir::FuncOp &toplevel){
+  interp.build(toplevel);
+  // sub-components of each create_comp by name
+  llvm::DenseMap<mlir::Value, llvm::StringMap<mlir::Value>> components;
   walkRegions(*toplevel.getCallableRegion(), [&](Block &block) {
     // build iter init_value map
     auto pop = block.getParentOp();
@@ -634,17 +1578,102 @@ void buildIdMap(mlir::FuncOp &toplevel){
         valueIds.insert({argument, argument});
     }
     for (Operation &operation : block) {
+      if (auto Op = llvm::dyn_cast<xilinx::equeue::CreateCompOp>(operation)) {
+        auto names = Op.getAttrOfType<ArrayAttr>("names");
+        auto &index = components[Op.getResult()];
+        for (unsigned i = 0; names && i < names.size(); i++)
+          index[names.getValue()[i].cast<StringAttr>().getValue()] =
+              valueIds[Op.getOperand(i)];
+      }
+      if (auto Op = llvm::dyn_cast<xilinx::equeue::GetCompOp>(operation)) {
+        auto it = components.find(valueIds[Op.comp()]);
+        Value sub = it == components.end() ? Value() : it->second.lookup(Op.name());
+        if (sub)
+          valueIds.insert({Op.getResult(), sub});
+        else {
+          Op.emitError("no sub-component named '") << Op.name() << "'";
+          failed = true;
+        }
+      }
       for (Value result : operation.getResults())
         valueIds.insert({result, result});
+      if (mlir::isa<xilinx::equeue::SplitContainerOp>(operation) ||
+          mlir::isa<xilinx::equeue::ConcatContainerOp>(operation))
+        hasViews = true;
     }
   });
 }
+/// frequency of a device in MHz, host and devices without one run at the
+/// default frequency
+uint64_t getFrequency(mlir::Operation *op){
+  auto attr = op ? op->getAttrOfType<IntegerAttr>("frequency") : IntegerAttr();
+  return attr && attr.getInt() > 0 ? attr.getInt() : DEFAULT_FREQUENCY;
+}
+uint64_t getTick(mlir::Operation *op){
+  return timeBase ? timeBase / getFrequency(op) : 1;
+}
+/// value of a hardware parameter, scaled in a sensitivity run
+double knob(const std::string &name, double value, uint64_t uid){
+  knobDevices[name] = uid;
+  if (std::find(parameters.begin(), parameters.end(), name) == parameters.end())
+    parameters.push_back(name);
+  auto it = perturbation.find(name);
+  if (it == perturbation.end()) return value;
+  applied[name] = it->second;
+  return value * it->second;
+}
+/// knob of whole cycles or lines, at least min; rounding may undo the change
+int intKnob(const std::string &name, int value, uint64_t uid, int min){
+  int scaled = std::max(int(llround(knob(name, value, uid))), min);
+  if (perturbation.count(name))
+    applied[name] = value ? double(scaled) / value : 1;
+  return scaled;
+}
+/// seeded latency distribution of a memory or DMA, see the latency attribute
+void setLatency(xilinx::equeue::Device *device, mlir::Operation *op){
+  auto dist = op->getAttrOfType<StringAttr>("latency");
+  if (!dist) return;
+  auto jitter = op->getAttrOfType<FloatAttr>("jitter");
+  device->setLatency(llvm::StringSwitch<xilinx::equeue::LatencyDist>(dist.getValue())
+      .Case("uniform", xilinx::equeue::LatencyDist::Uniform)
+      .Case("normal", xilinx::equeue::LatencyDist::Normal)
+      .Case("lognormal", xilinx::equeue::LatencyDist::LogNormal)
+      .Default(xilinx::equeue::LatencyDist::Fixed),
+    jitter ? jitter.getValueAsDouble() : 0.1, seed);
+}
+/// the time base is the least common multiple of all frequencies, so every
+/// device cycle is a whole number of ticks
+void buildClockDomains(mlir::FuncOp &toplevel){
+  bool hasFrequency = false;
+  uint64_t base = DEFAULT_FREQUENCY;
+  toplevel.walk([&](mlir::Operation *op){
+    if (failed) return;
+    if (!mlir::isa<xilinx::equeue::CreateProcOp>(op) &&
+        !mlir::isa<xilinx::equeue::CreateMemOp>(op) &&
+        !mlir::isa<xilinx::equeue::CreateDMAOp>(op))
+      return;
+    hasFrequency = hasFrequency || op->getAttr("frequency");
+    uint64_t f = getFrequency(op);
+    // least common multiple, a tick has to fit in 64 bits
+    uint64_t scale = f / llvm::GreatestCommonDivisor64(base, f);
+    if (base > std::numeric_limits<uint64_t>::max() / scale){
+      op->emitError("frequency ") << f << " MHz has no common multiple with the "
+        << "other clocks that fits in 64 bits";
+      failed = true;
+      return;
+    }
+    base *= scale;
+  });
+  timeBase = hasFrequency ? base : 0;
+  hostTable.tick = getTick(nullptr);
+}
 void buildExMap(mlir::FuncOp &toplevel){
   walkRegions(*toplevel.getCallableRegion(), [&](Block &block) {
     auto pop = block.getParentOp();
     uint64_t ex_times = 1;
     if( auto Op = llvm::dyn_cast<mlir::scf::ForOp>(pop) ) {
-      ex_times = getExTimes(pop);
+      // bounds computed at run time are not known yet, count one iteration
+      ex_times = std::max(getExTimes(pop), int64_t(1));
     }
     if( blockExs.count(pop->getBlock()) )
       blockExs.insert({&block, blockExs[pop->getBlock()]*ex_times});
@@ -652,8 +1681,183 @@ void buildExMap(mlir::FuncOp &toplevel){
       blockExs.insert({&block, ex_times});
   });
 }
+
+/// buildIdMap, buildExMap and buildClockDomains, or their results from the
+/// cache file a previous run on the same input left
+void analyze(mlir::FuncOp &toplevel, const std::string &cacheFile = ""){
+  auto start = std::chrono::steady_clock::now();
+  analysisCached = !cacheFile.empty() && loadAnalysis(toplevel, cacheFile);
+  if (!analysisCached){
+    buildIdMap(toplevel);
+    buildExMap(toplevel);
+    buildClockDomains(toplevel);
+    if (!cacheFile.empty() && !failed) saveAnalysis(toplevel, cacheFile);
+  }
+  analysisSeconds = std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start).count();
+}
+/// the keys of the cache file: values and blocks in walkRegions order
+void numberValues(mlir::FuncOp &toplevel, std::vector<mlir::Value> &values,
+                  llvm::DenseMap<mlir::Value, uint64_t> &ids,
+                  std::vector<mlir::Block *> &blocks){
+  walkRegions(*toplevel.getCallableRegion(), [&](Block &block) {
+    blocks.push_back(&block);
+    for (Value arg : block.getArguments()){
+      ids[arg] = values.size();
+      values.push_back(arg);
+    }
+    for (Operation &operation : block)
+      for (Value result : operation.getResults()){
+        ids[result] = values.size();
+        values.push_back(result);
+      }
+  });
+}
+/// little-endian uint64 words: magic, number of values and blocks, hasViews,
+/// timeBase, number of interpreter registers, the id each value maps to in
+/// valueIds, the register of each value, the pairs of iterInitValue and
+/// blockExs of each block; written to a temporary file first so that
+/// concurrent runs never see half a file
+void saveAnalysis(mlir::FuncOp &toplevel, const std::string &cacheFile){
+  std::vector<mlir::Value> values;
+  llvm::DenseMap<mlir::Value, uint64_t> ids;
+  std::vector<mlir::Block *> blocks;
+  numberValues(toplevel, values, ids, blocks);
+  std::vector<uint64_t> words = {CACHE_MAGIC, values.size(), blocks.size(),
+                                 hasViews, timeBase, interp.getNumRegisters()};
+  for (Value v : values)
+    words.push_back(ids.lookup(valueIds.lookup(v)));
+  for (Value v : values)
+    words.push_back(interp.getRegister(v));
+  words.push_back(iterInitValue.size());
+  for (auto &it : iterInitValue){
+    words.push_back(ids.lookup(it.first));
+    words.push_back(ids.lookup(it.second));
+  }
+  for (Block *b : blocks)
+    words.push_back(blockExs.lookup(b));
+
+  int fd;
+  llvm::SmallString<128> tmp;
+  if (llvm::sys::fs::createUniqueFile(cacheFile + "-%%%%%%", fd, tmp))
+    return;
+  {
+    llvm::raw_fd_ostream os(fd, /*shouldClose=*/true);
+    for (uint64_t w : words){
+      char buf[8];
+      llvm::support::endian::write64le(buf, w);
+      os.write(buf, 8);
+    }
+  }
+  if (llvm::sys::fs::rename(tmp, cacheFile))
+    llvm::sys::fs::remove(tmp);
+}
+/// false if there is no cache file or it does not match the program; the
+/// numbering of the values is the only walk of the program, the interpreter
+/// registers come from the file too
+bool loadAnalysis(mlir::FuncOp &toplevel, const std::string &cacheFile){
+  // large files are mapped, not read
+  auto file = llvm::MemoryBuffer::getFile(cacheFile, -1, false);
+  if (!file) return false;
+  llvm::StringRef data = (*file)->getBuffer();
+  uint64_t size = data.size() / 8;
+  auto word = [&](uint64_t i){
+    return llvm::support::endian::read64le(data.data() + 8 * i);
+  };
+  std::vector<mlir::Value> values;
+  llvm::DenseMap<mlir::Value, uint64_t> ids;
+  std::vector<mlir::Block *> blocks;
+  numberValues(toplevel, values, ids, blocks);
+  uint64_t n = values.size();
+  if (size < 7 + 2 * n || word(0) != CACHE_MAGIC || word(1) != n ||
+      word(2) != blocks.size())
+    return false;
+  uint64_t registers = word(5);
+  uint64_t iters = word(6 + 2 * n);
+  if (registers > n || size != 7 + 2 * n + 2 * iters + blocks.size())
+    return false;
+  std::vector<uint64_t> registerOf(n);
+  for (uint64_t i = 0; i < n; i++){
+    if (word(6 + i) >= n || word(6 + n + i) > registers) return false;
+    registerOf[i] = word(6 + n + i);
+  }
+  for (uint64_t i = 0; i < 2 * iters; i++)
+    if (word(7 + 2 * n + i) >= n) return false;
+
+  interp.restore(values, registerOf, registers);
+  hasViews = word(3);
+  timeBase = word(4);
+  valueIds.reserve(n);
+  for (uint64_t i = 0; i < n; i++)
+    valueIds[values[i]] = values[word(6 + i)];
+  for (uint64_t i = 0; i < iters; i++)
+    iterInitValue[values[word(7 + 2 * n + 2 * i)]] = values[word(8 + 2 * n + 2 * i)];
+  for (uint64_t i = 0; i < blocks.size(); i++)
+    blockExs[blocks[i]] = word(7 + 2 * n + 2 * iters + i);
+  hostTable.tick = getTick(nullptr);
+  return true;
+}
 // todo private:
 public:
+  // end-to-end latency and validity of the simulated program
+  uint64_t getTime() { return time; }
+  /// keep the ops of toplevel, resume compares edits of the IR against them
+  void recordProgram(mlir::FuncOp &toplevel){
+    program.clear();
+    toplevel.walk([&](mlir::Operation *op){
+      auto operands = op->getOperands();
+      program.push_back({op, op->getName(),
+        mlir::Builder(op->getContext()).getDictionaryAttr(op->getAttrs()),
+        llvm::SmallVector<mlir::Value, 4>(operands.begin(), operands.end())});
+    });
+  }
+  bool hasFailed() { return failed || interp.hasFailed(); }
+  /// simulate without writing the trace start and end
+  void simulate(mlir::FuncOp &toplevel){
+    analyze(toplevel);
+    simulateFunction(toplevel);
+  }
+  /// busy share of each launcher, per issue lane
+  std::map<std::string, double> utilization(){
+    std::map<std::string, double> u;
+    u[hostTable.name] = double(hostTable.busy) / time;
+    for (auto iter = launchTables.begin(); iter != launchTables.end(); iter++){
+      auto &l = iter->second;
+      u[l.name] = double(l.busy) / (time * std::max(l.pipeline_depth, uint64_t(1)));
+    }
+    return u;
+  }
+
+  // sensitivity analysis: factor of each scaled parameter, and the names of
+  // all parameters in creation order, e.g. SRAM_0.cycles_per_data
+  std::map<std::string, double> perturbation;
+  std::vector<std::string> parameters;
+  // factor each scaled parameter actually changed by, e.g. once rounded to
+  // whole cycles
+  std::map<std::string, double> applied;
+
+  // off for the runs of the Monte Carlo and sensitivity modes
+  bool tracing = true;
+  // wall-clock time of analyze and whether it loaded the cache file
+  double analysisSeconds = 0;
+  bool analysisCached = false;
+
+  // incremental re-simulation: state before step first, taken every
+  // checkpointInterval steps (0 for none), see resume
+  uint64_t checkpointInterval = 0;
+  std::vector<std::pair<uint64_t, std::shared_ptr<Runner>>> checkpoints;
+  // step a resumed run continued from
+  uint64_t resumedAt = 0;
+  // the ops of the baseline in walk order, and the first step each op was
+  // fetched; a resumed run starts before the first edited op was fetched
+  struct OpRecord {
+    mlir::Operation *op;
+    mlir::OperationName name;
+    mlir::DictionaryAttr attrs;
+    llvm::SmallVector<mlir::Value, 4> operands;
+  };
+  std::vector<OpRecord> program;
+  llvm::DenseMap<mlir::Operation *, uint64_t> firstFetch;
 
   // The valueMap associates each SSA statement in the program
   // with the number of time the value is produced.
@@ -664,7 +1868,7 @@ public:
   llvm::DenseMap<mlir::Operation *, uint64_t> opMap;
 
   uint64_t deviceId;
-  llvm::DenseMap<mlir::Value, std::unique_ptr<xilinx::equeue::Device> > deviceMap;
+  llvm::DenseMap<mlir::Value, DeviceHandle> deviceMap;
 
 private:
   std::ostream &traceStream;
@@ -682,12 +1886,139 @@ private:
 
   llvm::DenseMap<mlir::Value, mlir::Value> valueIds;
   llvm::DenseMap<mlir::Block *, uint64_t> blockExs;
+  // values of the std, scf and affine arithmetic, see Interpreter
+  Interpreter interp;
+
+  // first line of each allocated buffer
+  llvm::DenseMap<mlir::Operation *, uint64_t> allocAddr;
+  // ticks per microsecond, 0 when no device has a frequency and time is
+  // counted in cycles
+  uint64_t timeBase = 0;
+  // of the latency distributions
+  uint64_t seed;
+
+  // set when the simulated program is invalid, e.g. over-subscribes a memory
+  bool failed = false;
+  // bumped by every state change of a launcher, read by the watchdog
+  uint64_t progress = 0;
+  // steps of the event loop so far, and trace ids handed out
+  uint64_t step = 0;
+  uint64_t nextTid = 0;
+  // first step each device (by uid) was used, its create op, and the device
+  // of each knob
+  std::map<uint64_t, uint64_t> firstUse;
+  std::map<uint64_t, mlir::Operation *> deviceOps;
+  std::map<std::string, uint64_t> knobDevices;
+  // handle of each launcher by id, the host has none
+  std::vector<mlir::Value> launcherKeys{mlir::Value()};
+  // names used in statistics and trace, e.g. SRAM_0, in creation order
+  llvm::DenseMap<xilinx::equeue::Memory *, std::string> memoryNames;
+  llvm::StringMap<unsigned> memoryCounts;
+  std::vector<xilinx::equeue::Memory *> memories;
+  // in creation order, for statistics
+  std::vector<xilinx::equeue::DRAM *> drams;
+  std::vector<xilinx::equeue::Cache *> caches;
+
+  // overlap tracking between views, only once split/concat_container appear
+  struct PendingWrite {
+    mlir::Value buffer;
+    xilinx::equeue::Region region;
+    uint64_t end;
+  };
+  bool hasViews = false;
+  llvm::DenseMap<xilinx::equeue::Memory *, std::vector<PendingWrite>> pendingWrites;
+  uint64_t overlapConflicts = 0;
 }; // Runner
 }
 
 namespace acdc {
 
-void CommandProcessor::run(mlir::ModuleOp module) {
+SimulationResult CommandProcessor::simulate(mlir::FuncOp func) {
+  std::ostream nullStream(nullptr);
+  Runner runner(nullStream, seed);
+  runner.tracing = false;
+  runner.simulate(func);
+  SimulationResult result;
+  result.latency = runner.getTime();
+  result.failed = runner.hasFailed();
+  result.utilization = runner.utilization();
+  return result;
+}
+
+LogicalResult CommandProcessor::checkpoint(mlir::ModuleOp module,
+                                           Checkpoints &checkpoints) {
+  mlir::FuncOp toplevel = module.lookupSymbol<mlir::FuncOp>("graph");
+  if (!toplevel) {
+    llvm::errs() << "Toplevel function graph not found!\n";
+    return failure();
+  }
+  // the runs resumed from it share the trace stream, tracing is off
+  auto baseline = std::make_shared<Runner>(traceStream, seed);
+  baseline->tracing = false;
+  baseline->checkpointInterval = 64;
+  baseline->simulate(toplevel);
+  baseline->recordProgram(toplevel);
+  checkpoints.toplevel = toplevel;
+  checkpoints.baseline = baseline;
+  checkpoints.result.latency = baseline->getTime();
+  checkpoints.result.failed = baseline->hasFailed();
+  checkpoints.result.utilization = baseline->utilization();
+  latency = baseline->getTime();
+  return failure(baseline->hasFailed());
+}
+
+LogicalResult CommandProcessor::resume(const Checkpoints &checkpoints,
+                                       const std::map<std::string, double> &changes,
+                                       SimulationResult &result, bool verify) {
+  auto &baseline = *checkpoints.baseline;
+  mlir::FuncOp toplevel = checkpoints.toplevel;
+  auto &params = baseline.parameters;
+  for (auto &change : changes)
+    if (std::find(params.begin(), params.end(), change.first) == params.end()) {
+      auto diag = toplevel.emitError("'") << change.first
+        << "' is not a hardware parameter of the program";
+      diag.attachNote() << "loop bounds are part of the program, edit it and "
+                           "resume, e.g. with -what-if-edit";
+      return failure();
+    }
+  auto full = [&] {
+    auto r = std::make_shared<Runner>(traceStream, seed);
+    r->tracing = false;
+    r->perturbation = changes;
+    r->simulate(toplevel);
+    return r;
+  };
+  auto runner = baseline.resume(changes, toplevel);
+  if (!runner)
+    runner = full();
+  result.latency = runner->getTime();
+  result.failed = runner->hasFailed();
+  result.utilization = runner->utilization();
+  result.resumedAt = runner->resumedAt;
+  latency = result.latency;
+  if (verify) {
+    auto check = full();
+    if (check->getTime() != runner->getTime() ||
+        check->hasFailed() != runner->hasFailed()) {
+      llvm::errs() << "error: the resumed run differs from the full rerun, latency "
+                   << runner->getTime() << " instead of " << check->getTime() << "\n";
+      return failure();
+    }
+  }
+  return failure(result.failed);
+}
+
+std::string CommandProcessor::cacheFileFor(llvm::StringRef dir, llvm::StringRef text) {
+  llvm::MD5 hash;
+  hash.update(text);
+  llvm::MD5::MD5Result result;
+  hash.final(result);
+  llvm::SmallString<128> path(dir);
+  llvm::sys::path::append(path, result.digest().str() + ".eqcache");
+  return path.str().str();
+}
+
+LogicalResult CommandProcessor::run(mlir::ModuleOp module) {
 
   std::string topLevelFunction("graph");
   mlir::Operation *mainP = module.lookupSymbol(topLevelFunction);
@@ -704,7 +2035,7 @@ void CommandProcessor::run(mlir::ModuleOp module) {
   mlir::Block::BlockArgListType blockArgs;
 
 
-  Runner runner(traceStream);
+  Runner runner(traceStream, seed);
 
   // The number of inputs to the function in the IR.
   unsigned numInputs = 0;
@@ -712,8 +2043,7 @@ void CommandProcessor::run(mlir::ModuleOp module) {
 
   if (mlir::FuncOp toplevel =
       module.lookupSymbol<mlir::FuncOp>(topLevelFunction)) {
-    runner.buildIdMap(toplevel);
-    runner.buildExMap(toplevel);
+    runner.analyze(toplevel, cacheFile);
     ftype = toplevel.getType();
     mlir::Block &entryBlock = toplevel.getBody().front();
     blockArgs = entryBlock.getArguments();
@@ -737,7 +2067,6 @@ void CommandProcessor::run(mlir::ModuleOp module) {
     }
   }
 
-  std::vector<llvm::Any> results(numOutputs);
   std::vector<uint64_t> resultTimes(numOutputs);
   if(mlir::FuncOp toplevel =
      module.lookupSymbol<mlir::FuncOp>(topLevelFunction)) {
@@ -764,7 +2093,199 @@ void CommandProcessor::run(mlir::ModuleOp module) {
   #endif
 
   runner.emitTraceEnd(traceStream);
-
+  latency = runner.getTime();
+  if (printStats){
+    runner.printStatistics(*statsStream);
+    if (!cacheFile.empty())
+      *statsStream << "analysis: "
+                   << llvm::format("%.3f", runner.analysisSeconds * 1000)
+                   << " ms, " << (runner.analysisCached ? "loaded from" : "saved to")
+                   << " the cache\n";
+  }
+  return failure(runner.hasFailed());
 }// CommandProcessor::run
 
+LogicalResult CommandProcessor::runSensitivity(mlir::ModuleOp module, double delta,
+                                               unsigned threads, bool verify) {
+  mlir::FuncOp toplevel = module.lookupSymbol<mlir::FuncOp>("graph");
+  if (!toplevel) {
+    llvm::errs() << "Toplevel function graph not found!\n";
+    return failure();
+  }
+  std::ostream nullStream(nullptr);
+  Runner baseline(nullStream, seed);
+  baseline.tracing = false;
+  // the perturbed runs resume from these
+  baseline.checkpointInterval = 64;
+  baseline.simulate(toplevel);
+  if (baseline.hasFailed())
+    return failure();
+  uint64_t base = baseline.getTime();
+  auto baseUtil = baseline.utilization();
+  auto &params = baseline.parameters;
+
+  // runs 2i and 2i+1 scale parameter i down and up, all with the same seed
+  struct Run {
+    uint64_t time;
+    bool failed;
+    std::map<std::string, double> util;
+    // the full rerun differs from the incremental one
+    bool mismatch;
+    // the parameter changed by, see Runner::applied
+    double factor;
+  };
+  std::vector<Run> runs(2 * params.size());
+  llvm::ThreadPool pool(llvm::hardware_concurrency(threads));
+  for (unsigned i = 0; i < runs.size(); i++)
+    pool.async([&, i] {
+      std::map<std::string, double> perturb{
+        {params[i / 2], i % 2 ? 1 + delta : 1 - delta}};
+      auto runner = baseline.resume(perturb, toplevel);
+      std::ostream nullStream(nullptr);
+      auto full = [&] {
+        auto r = std::make_shared<Runner>(nullStream, seed);
+        r->tracing = false;
+        r->perturbation = perturb;
+        r->simulate(toplevel);
+        return r;
+      };
+      if (!runner)
+        runner = full();
+      auto applied = runner->applied.find(params[i / 2]);
+      runs[i] = {runner->getTime(), runner->hasFailed(), runner->utilization(), false,
+                 applied == runner->applied.end() ? 1.0 : applied->second};
+      if (verify) {
+        auto check = full();
+        runs[i].mismatch = check->getTime() != runs[i].time ||
+                           check->hasFailed() != runs[i].failed;
+      }
+    });
+  pool.wait();
+  unsigned mismatches = 0;
+  for (unsigned i = 0; i < runs.size(); i++)
+    if (runs[i].mismatch) {
+      llvm::errs() << "incremental run of " << params[i / 2]
+                   << (i % 2 ? " +" : " -") << " differs from the full rerun\n";
+      mismatches++;
+    }
+
+  // elasticity: relative change of the latency per relative change the
+  // parameter actually made, a failed run (e.g. a memory too small) ranks
+  // first; a parameter rounded back to its value tells nothing
+  struct Row {
+    std::string param;
+    double elasticity;
+    std::string device;
+    double util;
+  };
+  std::vector<Row> rows;
+  std::vector<std::string> insensitive;
+  for (unsigned p = 0; p < params.size(); p++) {
+    auto &down = runs[2 * p], &up = runs[2 * p + 1];
+    Row row{params[p], 0, "", 0};
+    double change = up.factor - down.factor;
+    if (down.failed || up.failed)
+      row.elasticity = INFINITY;
+    else if (change == 0) {
+      insensitive.push_back(params[p]);
+      continue;
+    } else
+      row.elasticity = (double(up.time) - double(down.time)) / base / change;
+    // launcher whose utilization moves the most
+    for (auto &u : baseUtil) {
+      double change = up.util[u.first] - down.util[u.first];
+      if (std::abs(change) > std::abs(row.util)) {
+        row.device = u.first;
+        row.util = change;
+      }
+    }
+    rows.push_back(row);
+  }
+  std::stable_sort(rows.begin(), rows.end(), [](const Row &a, const Row &b) {
+    return std::abs(a.elasticity) != std::abs(b.elasticity) ?
+      std::abs(a.elasticity) > std::abs(b.elasticity) : std::abs(a.util) > std::abs(b.util);
+  });
+
+  auto &os = llvm::outs();
+  os << "sensitivity: +-" << llvm::format("%.0f", 100 * delta) << "%, baseline time "
+     << base << "\n";
+  os << llvm::format("%-32s %12s %12s %11s %-16s %10s\n", "parameter", "time -",
+    "time +", "elasticity", "utilization", "change");
+  for (auto &row : rows) {
+    unsigned p = std::find(params.begin(), params.end(), row.param) - params.begin();
+    auto &down = runs[2 * p], &up = runs[2 * p + 1];
+    auto time = [](const Run &r) {
+      return r.failed ? std::string("failed") : std::to_string(r.time);
+    };
+    os << llvm::format("%-32s %12s %12s %11.3f %-16s %9.1f%%\n", row.param.c_str(),
+      time(down).c_str(), time(up).c_str(), row.elasticity, row.device.c_str(),
+      100 * row.util);
+  }
+  if (!insensitive.empty()) {
+    os << "insensitive at this delta:";
+    for (auto &param : insensitive)
+      os << " " << param;
+    os << "\n";
+  }
+  return failure(mismatches > 0);
+}
+
+LogicalResult CommandProcessor::runMonteCarlo(mlir::ModuleOp module, unsigned runs,
+                                              unsigned threads) {
+  mlir::FuncOp toplevel = module.lookupSymbol<mlir::FuncOp>("graph");
+  if (!toplevel) {
+    llvm::errs() << "Toplevel function graph not found!\n";
+    return failure();
+  }
+  // runs only read the module, each one owns its runner and devices
+  std::vector<uint64_t> times(runs);
+  std::vector<std::string> realTimes(runs);
+  std::vector<char> failedRuns(runs);
+  llvm::ThreadPool pool(llvm::hardware_concurrency(threads));
+  for (unsigned i = 0; i < runs; i++)
+    pool.async([&, i] {
+      // traces of the runs are dropped
+      std::ostream nullStream(nullptr);
+      Runner runner(nullStream, seed + i);
+      runner.tracing = false;
+      runner.simulate(toplevel);
+      times[i] = runner.getTime();
+      realTimes[i] = runner.formatTime(times[i]);
+      failedRuns[i] = runner.hasFailed();
+    });
+  pool.wait();
+
+  std::vector<unsigned> order;
+  for (unsigned i = 0; i < runs; i++)
+    if (!failedRuns[i]) order.push_back(i);
+  std::stable_sort(order.begin(), order.end(),
+    [&](unsigned a, unsigned b){ return times[a] < times[b]; });
+  unsigned failures = runs - order.size();
+
+  auto &os = llvm::outs();
+  os << "monte carlo: " << runs << " runs, seeds " << seed << " to "
+     << seed + runs - 1;
+  if (failures) os << ", " << failures << " failed";
+  os << "\n";
+  if (order.empty()) return failure();
+  double mean = 0;
+  for (auto i : order) mean += double(times[i]) / order.size();
+  os << llvm::format("%-8s %14s %14s %10s\n", "", "time", "real time", "seed");
+  // nearest rank, the seed reproduces the run
+  auto row = [&](const char *name, double p) {
+    unsigned rank = std::max(unsigned(std::ceil(p * order.size())), 1u) - 1;
+    unsigned i = order[rank];
+    os << llvm::format("%-8s %14llu %14s %10llu\n", name,
+      (unsigned long long)times[i], realTimes[i].c_str(),
+      (unsigned long long)(seed + i));
+  };
+  row("min", 0);
+  row("p50", 0.50);
+  row("p95", 0.95);
+  row("p99", 0.99);
+  row("max", 1);
+  os << llvm::format("%-8s %14.1f\n", "mean", mean);
+  return failure(failures > 0);
+}
+
 } // namespace acdc
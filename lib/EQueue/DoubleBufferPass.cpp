@@ -0,0 +1,247 @@
+//===- DoubleBufferPass.cpp -------------------------------------*- C++ -*-===//
+//
+// This file is licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// Double buffering of memcpy -> launch -> memcpy chains in loops whose
+// iterations are ordered by a signal iter_arg. The loop is unrolled by two,
+// the odd iterations use second buffers, and each half only waits for the
+// previous use of its own buffers. The simulator decides whether a rewrite
+// is kept.
+//
+//===----------------------------------------------------------------------===//
+
+#include "EQueue/EQueuePasses.h"
+#include "EQueue/EQueueOps.h"
+
+#include "mlir/Dialect/SCF/SCF.h"
+#include "mlir/Dialect/StandardOps/IR/Ops.h"
+#include "mlir/IR/BlockAndValueMapping.h"
+#include "mlir/IR/Builders.h"
+#include "mlir/IR/Diagnostics.h"
+#include "mlir/IR/Function.h"
+#include "mlir/IR/Module.h"
+#include "llvm/ADT/STLExtras.h"
+
+#include <sstream>
+
+using namespace mlir;
+namespace xilinx {
+namespace equeue {
+
+namespace {
+/// the first memcpy fills a buffer the launch reads, the last one drains a
+/// buffer the launch writes; the last memcpy ends the iteration
+struct Chain {
+  scf::ForOp forOp;
+  MemCopyOp in;
+  LaunchOp launch;
+  MemCopyOp out;
+  int64_t lb, step, trip;
+};
+} // namespace
+
+static bool getConstantIndex(Value v, int64_t &result){
+  auto constantOp = v.getDefiningOp<ConstantOp>();
+  if (!constantOp) return false;
+  auto attr = constantOp.getValue().dyn_cast<IntegerAttr>();
+  if (!attr) return false;
+  result = attr.getInt();
+  return true;
+}
+
+/// allocated outside forOp, and only deallocated outside of it
+static bool isLoopBuffer(Value buffer, scf::ForOp forOp){
+  auto allocOp = buffer.getDefiningOp<MemAllocOp>();
+  if (!allocOp || forOp.getOperation()->isAncestor(allocOp)) return false;
+  for (Operation *user : buffer.getUsers())
+    if (!forOp.getOperation()->isAncestor(user) && !llvm::isa<MemDeallocOp>(user))
+      return false;
+  return true;
+}
+
+static bool isLaunchOperand(LaunchOp launch, Value v){
+  return llvm::is_contained(launch.getLaunchOperands(), v);
+}
+
+static bool matchChain(scf::ForOp forOp, Chain &c){
+  if (forOp.getNumRegionIterArgs() != 1) return false;
+  Value iterArg = forOp.getRegionIterArgs()[0];
+  if (!iterArg.getType().isa<EQueueSignalType>() || !iterArg.hasOneUse())
+    return false;
+  int64_t ub;
+  if (!getConstantIndex(forOp.lowerBound(), c.lb) ||
+      !getConstantIndex(forOp.upperBound(), ub) ||
+      !getConstantIndex(forOp.step(), c.step) || c.step <= 0)
+    return false;
+  c.trip = ub > c.lb ? (ub - c.lb + c.step - 1) / c.step : 0;
+  if (c.trip < 2) return false;
+  c.forOp = forOp;
+
+  Block *body = forOp.getBody();
+  c.in = llvm::dyn_cast<MemCopyOp>(*iterArg.getUsers().begin());
+  if (!c.in || c.in.getOperation()->getBlock() != body ||
+      c.in.getOperand(0) != iterArg)
+    return false;
+  c.out = body->getTerminator()->getOperand(0).getDefiningOp<MemCopyOp>();
+  if (!c.out || c.out.getOperation()->getBlock() != body) return false;
+  c.launch = c.out.getOperand(0).getDefiningOp<LaunchOp>();
+  if (!c.launch || c.launch.getOperation()->getBlock() != body ||
+      c.out.getOperand(0) != c.launch.getOperation()->getResult(0))
+    return false;
+  // the launch starts once the buffer is filled, maybe joined with others
+  Value start = c.launch.getStartSignal();
+  Value filled = c.in.getResult();
+  auto andOp = start.getDefiningOp<ControlAndOp>();
+  if (start != filled &&
+      !(andOp && llvm::is_contained(andOp.getOperation()->getOperands(), filled)))
+    return false;
+  return isLaunchOperand(c.launch, c.in.getDestBuffer()) &&
+         isLaunchOperand(c.launch, c.out.getSrcBuffer()) &&
+         isLoopBuffer(c.in.getDestBuffer(), forOp) &&
+         isLoopBuffer(c.out.getSrcBuffer(), forOp);
+}
+
+static SmallVector<Chain, 4> collectChains(FuncOp func){
+  SmallVector<Chain, 4> chains;
+  func.walk([&](scf::ForOp forOp){
+    Chain c;
+    if (matchChain(forOp, c)) chains.push_back(c);
+  });
+  return chains;
+}
+
+/// a second buffer next to buffer, deallocated with it
+static Value duplicateBuffer(Value buffer){
+  Operation *allocOp = buffer.getDefiningOp();
+  OpBuilder builder(allocOp->getContext());
+  builder.setInsertionPointAfter(allocOp);
+  Value copy = builder.clone(*allocOp)->getResult(0);
+  for (Operation *user : buffer.getUsers())
+    if (llvm::isa<MemDeallocOp>(user)){
+      builder.setInsertionPointAfter(user);
+      OperationState state(user->getLoc(), MemDeallocOp::getOperationName());
+      state.addOperands(copy);
+      builder.createOperation(state);
+    }
+  return copy;
+}
+
+/// unroll by two into a ping-pong loop with one signal per buffer set; an
+/// odd iteration left over runs after the loop on the first set
+static void doubleBuffer(Chain &c){
+  scf::ForOp forOp = c.forOp;
+  Value inBuffer = c.in.getDestBuffer();
+  Value outBuffer = c.out.getSrcBuffer();
+  Value inBuffer2 = duplicateBuffer(inBuffer);
+  Value outBuffer2 = outBuffer == inBuffer ? inBuffer2 : duplicateBuffer(outBuffer);
+
+  OpBuilder builder(forOp);
+  Location loc = forOp.getLoc();
+  Block *body = forOp.getBody();
+  Value yielded = body->getTerminator()->getOperand(0);
+  // the body for iteration iv, started by signal; returns its end signal
+  auto cloneBody = [&](Value iv, Value signal, bool second) -> Value {
+    BlockAndValueMapping mapping;
+    mapping.map(forOp.getInductionVar(), iv);
+    mapping.map(forOp.getRegionIterArgs()[0], signal);
+    if (second){
+      mapping.map(inBuffer, inBuffer2);
+      mapping.map(outBuffer, outBuffer2);
+    }
+    for (Operation &op : body->without_terminator())
+      builder.clone(op, mapping);
+    return mapping.lookupOrDefault(yielded);
+  };
+
+  Value init = forOp.getIterOperands()[0];
+  int64_t pairs = c.trip / 2;
+  Value ub = builder.create<ConstantIndexOp>(loc, c.lb + pairs * 2 * c.step);
+  Value step2 = builder.create<ConstantIndexOp>(loc, 2 * c.step);
+  auto pingPong = builder.create<scf::ForOp>(loc, forOp.lowerBound(), ub, step2,
+                                             ValueRange{init, init});
+  builder.setInsertionPointToStart(pingPong.getBody());
+  Value iv = pingPong.getInductionVar();
+  Value ping = cloneBody(iv, pingPong.getRegionIterArgs()[0], false);
+  Value step = builder.create<ConstantIndexOp>(loc, c.step);
+  Value ivNext = builder.create<AddIOp>(loc, iv, step);
+  Value pong = cloneBody(ivNext, pingPong.getRegionIterArgs()[1], true);
+  builder.create<scf::YieldOp>(loc, ValueRange{ping, pong});
+
+  builder.setInsertionPointAfter(pingPong);
+  Value pingDone = pingPong.getResult(0);
+  Value pongDone = pingPong.getResult(1);
+  if (c.trip % 2){
+    Value last = builder.create<ConstantIndexOp>(loc, c.lb + (c.trip - 1) * c.step);
+    pingDone = cloneBody(last, pingDone, false);
+  }
+  OperationState state(loc, ControlAndOp::getOperationName());
+  state.addOperands({pingDone, pongDone});
+  state.addTypes(forOp.getResult(0).getType());
+  Value done = builder.createOperation(state)->getResult(0);
+  forOp.getResult(0).replaceAllUsesWith(done);
+  forOp.erase();
+}
+
+namespace {
+struct DoubleBufferPass
+    : public PassWrapper<DoubleBufferPass, OperationPass<ModuleOp>> {
+  void runOnOperation() override {
+    for (FuncOp func : getOperation().getOps<FuncOp>())
+      if (!func.isExternal() && SimulationAnalysis::isEntry(func))
+        optimize(func);
+  }
+
+  /// try the chains one by one on a copy of func, keep a rewrite if the
+  /// simulated latency drops; a rewritten chain no longer matches
+  void optimize(FuncOp func){
+    auto &base = getChildAnalysis<SimulationAnalysis>(func);
+    if (base.result.failed) return;
+    uint64_t latency = base.result.latency;
+    auto seed = func.getAttrOfType<IntegerAttr>("equeue.seed");
+    std::ostream nullStream(nullptr);
+    acdc::CommandProcessor proc(nullStream, false, seed ? seed.getInt() : 1);
+
+    unsigned skip = 0;
+    while (true){
+      FuncOp trial = func.clone();
+      auto chains = collectChains(trial);
+      if (skip >= chains.size()){
+        trial.erase();
+        break;
+      }
+      doubleBuffer(chains[skip]);
+      acdc::SimulationResult result;
+      {
+        // a second buffer that does not fit fails the trial, not the pass
+        ScopedDiagnosticHandler quiet(&getContext(),
+                                      [](Diagnostic &){ return success(); });
+        result = proc.simulate(trial);
+      }
+      if (!result.failed && result.latency < latency){
+        latency = result.latency;
+        func.getBody().takeBody(trial.getBody());
+      } else {
+        skip++;
+      }
+      trial.erase();
+    }
+  }
+};
+} // namespace
+
+std::unique_ptr<Pass> createDoubleBufferPass(){
+  return std::make_unique<DoubleBufferPass>();
+}
+
+void registerDoubleBufferPass(){
+  PassRegistration<DoubleBufferPass>("equeue-double-buffer",
+    "Double-buffer memcpy -> launch -> memcpy chains in loops when the "
+    "simulated latency drops");
+}
+
+} // namespace equeue
+} // namespace xilinx
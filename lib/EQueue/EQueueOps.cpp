@@ -25,7 +25,9 @@
 #include "mlir/IR/DialectImplementation.h"
 #include "mlir/IR/PatternMatch.h"
 #include "mlir/IR/StandardTypes.h"
+#include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringSet.h"
 #include "llvm/Support/raw_ostream.h"
 
 using namespace mlir;
@@ -40,7 +42,9 @@ void CreateDMAOp::build(Builder builder, OperationState &result) {
 	result.types.push_back(i32Type);
 }
 void print(OpAsmPrinter &p, CreateDMAOp op) {
-  p << "\"equeue.create_dma\"():()->i32";
+  p << "\"equeue.create_dma\"()";
+  p.printOptionalAttrDict(op.getAttrs());
+  p << " : () -> i32";
 }
 
 //===----------------------------------------------------------------------===//
@@ -51,10 +55,20 @@ static ParseResult parseCreateMemOp(OpAsmParser &parser,
 	Attribute extentsRaw;
 		StringRef data, type;
 	NamedAttrList dummy;
+	OpAsmParser::OperandType parent;
+	bool hasParent = false;
 	if (parser.parseAttribute(extentsRaw, "shape", dummy) || 
 			parser.parseComma() || parser.parseKeyword(&data) || 
 			parser.parseComma() || parser.parseKeyword(&type))
 		return failure();
+	// a cache names its parent memory: Cache(%mem)
+	if (succeeded(parser.parseOptionalLParen())){
+		if (parser.parseOperand(parent) || parser.parseRParen())
+			return failure();
+		hasParent = true;
+	}
+	if (parser.parseOptionalAttrDict(result.attributes))
+		return failure();
 	auto extentsArray = extentsRaw.dyn_cast<ArrayAttr>();
 	if (!extentsArray)
 		return failure();
@@ -70,10 +84,24 @@ static ParseResult parseCreateMemOp(OpAsmParser &parser,
 	result.addAttribute("data", parser.getBuilder().getStringAttr(data));
 	result.addAttribute("type", parser.getBuilder().getStringAttr(type));
 	auto i32Type = IntegerType::get(32, builder.getContext());
+	if (hasParent && parser.resolveOperand(parent, i32Type, result.operands))
+		return failure();
 	result.types.push_back(i32Type);
 	return success();
 }
 
+static LogicalResult verify(CreateMemOp op) {
+	if (!op.parent())
+		return success();
+	if (op.getMemType() != "Cache")
+		return op.emitOpError("only a Cache has a parent memory, not ")
+			<< op.getMemType();
+	auto def = op.parent().getDefiningOp();
+	if (def && !isa<CreateMemOp>(def))
+		return op.emitOpError("parent must be a memory");
+	return success();
+}
+
 
 //===----------------------------------------------------------------------===//
 // CreateProcOp 
@@ -81,7 +109,8 @@ static ParseResult parseCreateMemOp(OpAsmParser &parser,
 static ParseResult parseCreateProcOp(OpAsmParser &parser,
                                      OperationState &result) {
 	StringRef type;
-	if (parser.parseKeyword(&type))
+	if (parser.parseKeyword(&type) || 
+			parser.parseOptionalAttrDict(result.attributes))
 		return failure();
 
 	Builder &builder = parser.getBuilder();
@@ -92,7 +121,54 @@ static ParseResult parseCreateProcOp(OpAsmParser &parser,
 }
 
 
+//===----------------------------------------------------------------------===//
+// CreateCompOp 
+//===----------------------------------------------------------------------===//
+static LogicalResult verify(CreateCompOp op) {
+	auto names = op.getAttrOfType<ArrayAttr>("names");
+	if (!names)
+		return success();
+	if (names.size() != op.getNumOperands())
+		return op.emitOpError("has ") << op.getNumOperands() << " sub-components but "
+			<< names.size() << " names";
+	llvm::StringSet<> seen;
+	for (Attribute name : names)
+		if (!seen.insert(name.cast<StringAttr>().getValue()).second)
+			return op.emitOpError("names two sub-components '")
+				<< name.cast<StringAttr>().getValue() << "'";
+	return success();
+}
 
+//===----------------------------------------------------------------------===//
+// GetCompOp 
+//===----------------------------------------------------------------------===//
+static ParseResult parseGetCompOp(OpAsmParser &parser,
+                                  OperationState &result) {
+	OpAsmParser::OperandType comp;
+	Attribute name;
+	auto i32Type = IntegerType::get(32, parser.getBuilder().getContext());
+	if (parser.parseOperand(comp) || parser.parseComma() ||
+			parser.parseAttribute(name, "name", result.attributes) ||
+			parser.parseOptionalAttrDict(result.attributes) ||
+			parser.resolveOperand(comp, i32Type, result.operands))
+		return failure();
+	if (!name.isa<StringAttr>())
+		return parser.emitError(parser.getNameLoc(), "expected a sub-component name");
+	result.types.push_back(i32Type);
+	return success();
+}
+void print(OpAsmPrinter &p, GetCompOp op) {
+	p << "equeue.get_comp " << op.comp() << ", " << op.nameAttr();
+	p.printOptionalAttrDict(op.getAttrs(), /*elidedAttrs=*/{"name"});
+}
+// a component passed into a launch is only resolved by the simulator
+static LogicalResult verify(GetCompOp op) {
+	auto comp = op.comp().getDefiningOp<CreateCompOp>();
+	if (comp && !comp.getComponent(op.name()))
+		return op.emitOpError("component has no sub-component named '")
+			<< op.name() << "'";
+	return success();
+}
 
 //===----------------------------------------------------------------------===//
 // MemAllocOp 
@@ -206,6 +282,239 @@ static ParseResult parseLaunchOp(OpAsmParser &parser,
 	return success();
 }
 
+//===----------------------------------------------------------------------===//
+// Memory accesses
+//===----------------------------------------------------------------------===//
+/// data lines of a buffer, 0 if its type does not tell
+static int64_t getVolume(Value buffer) {
+	auto type = buffer.getType().cast<EQueueContainerType>().getValueType();
+	if (auto shaped = type.dyn_cast<ShapedType>())
+		return shaped.hasStaticShape() ? shaped.getNumElements() : 0;
+	return 1;
+}
+
+/// row-major line offset of the indices into a buffer, like the simulator
+/// computes it, None unless all of them are constants
+static Optional<int64_t> getConstantOffset(Value buffer, ValueRange indices) {
+	ArrayRef<int64_t> shape;
+	auto type = buffer.getType().cast<EQueueContainerType>().getValueType();
+	if (auto shaped = type.dyn_cast<ShapedType>())
+		shape = shaped.getShape();
+	int64_t offset = 0;
+	for (unsigned dim = 0; dim < indices.size(); dim++) {
+		auto index = indices[dim].getDefiningOp<ConstantIndexOp>();
+		if (!index)
+			return llvm::None;
+		int64_t stride = 1;
+		for (unsigned d = dim + 1; d < shape.size(); d++)
+			stride *= shape[d];
+		offset += index.getValue() * stride;
+	}
+	return offset;
+}
+
+/// size and stride are positive, lines of a window at a known offset of a
+/// buffer of known volume lie inside the buffer
+static LogicalResult verifyWindow(Operation *op, int64_t lines,
+                                  Optional<int64_t> offset, int64_t volume) {
+	auto size = op->getAttrOfType<IntegerAttr>("size");
+	auto stride = op->getAttrOfType<IntegerAttr>("stride");
+	if (size && size.getInt() <= 0)
+		return op->emitOpError("size must be positive, not ") << size.getInt();
+	if (stride && stride.getInt() <= 0)
+		return op->emitOpError("stride must be positive, not ") << stride.getInt();
+	if (!offset || !volume)
+		return success();
+	int64_t last = *offset + (lines - 1) * (stride ? stride.getInt() : 1);
+	if (*offset < 0 || last >= volume)
+		return op->emitOpError("accesses lines ") << *offset << " to " << last
+			<< " of a buffer of " << volume << " lines";
+	return success();
+}
+
+static LogicalResult verify(MemReadOp op) {
+	int64_t volume = getVolume(op.getBuffer());
+	return verifyWindow(op, op.getSize(op.hasOffset() ? 1 : volume),
+		getConstantOffset(op.getBuffer(), op.getIndex()), volume);
+}
+
+static LogicalResult verify(MemWriteOp op) {
+	int64_t volume = getVolume(op.getBuffer());
+	return verifyWindow(op, op.getSize(op.hasOffset() ? 1 : volume),
+		getConstantOffset(op.getBuffer(), op.getIndex()), volume);
+}
+
+/// the window is in the larger buffer, the smaller one is copied as a whole
+static LogicalResult verify(MemCopyOp op) {
+	int64_t src = getVolume(op.getSrcBuffer());
+	int64_t dest = getVolume(op.getDestBuffer());
+	int64_t window = src && dest ? std::max(src, dest) : 0;
+	int64_t other = std::min(src, dest);
+	int64_t lines = op.getSize(other);
+	// the offset counts lines, whatever the shape of the buffer
+	Optional<int64_t> offset = 0;
+	if (op.offset()) {
+		auto index = op.offset().getDefiningOp<ConstantIndexOp>();
+		offset = index ? Optional<int64_t>(index.getValue()) : llvm::None;
+	}
+	if (failed(verifyWindow(op, lines, offset, window)))
+		return failure();
+	if (window && lines > other)
+		return op.emitOpError("copies ") << lines << " lines to or from a buffer of "
+			<< other << " lines";
+	return success();
+}
+
+//===----------------------------------------------------------------------===//
+// Container views
+//===----------------------------------------------------------------------===//
+static LogicalResult verify(SplitContainerOp op) {
+	auto sizes = op.getAttrOfType<ArrayAttr>("sizes");
+	if (sizes.size() != op.getNumResults())
+		return op.emitOpError("has ") << op.getNumResults() << " views but "
+			<< sizes.size() << " sizes";
+	int64_t total = 0;
+	for (unsigned view = 0; view < sizes.size(); view++) {
+		int64_t size = op.getSize(view);
+		if (size <= 0)
+			return op.emitOpError("view ") << view << " must have a positive size";
+		total += size;
+	}
+	int64_t volume = getVolume(op.getBuffer());
+	if (volume && total != volume)
+		return op.emitOpError("sizes add up to ") << total << " lines, the buffer has "
+			<< volume;
+	return success();
+}
+
+/// the memory handler of the alloc behind a buffer, looking through views
+static Value getMemHandler(Value buffer) {
+	while (Operation *def = buffer.getDefiningOp()) {
+		if (auto alloc = dyn_cast<MemAllocOp>(def))
+			return alloc.getMemHandler();
+		if (!isa<SplitContainerOp>(def) && !isa<ConcatContainerOp>(def))
+			break;
+		buffer = def->getOperand(0);
+	}
+	return {};
+}
+
+static LogicalResult verify(ConcatContainerOp op) {
+	if (op.getNumOperands() == 0)
+		return op.emitOpError("needs at least one buffer");
+	// buffers passed into a launch are only known while simulating
+	Value mem;
+	for (Value buffer : op.getOperands()) {
+		Value handler = getMemHandler(buffer);
+		if (!handler)
+			continue;
+		if (mem && handler != mem)
+			return op.emitOpError("buffers must live on the same memory");
+		mem = handler;
+	}
+	return success();
+}
+
+//===----------------------------------------------------------------------===//
+// Control ops
+//===----------------------------------------------------------------------===//
+// The rewrites keep the time of every event. Control ops sit in the event
+// queue of their launcher, which is looked at in order: a signal of a control
+// op earlier in the block is done once a later control op of the block is
+// looked at, so waiting for it is free. An await enters no queue and retires
+// at once when its signals are done.
+
+/// a control_start in the block of op enters the event queue of the
+/// launcher before op and is done once it is looked at
+static bool isLocalStart(Value in, Operation *op) {
+  Operation *def = in.getDefiningOp();
+  return def && def->getBlock() == op->getBlock() && isa<ControlStartOp>(def);
+}
+
+/// a control_and of the signal of the control op right before it is pushed
+/// into the same queue in the same fetch and is done with that op
+OpFoldResult ControlAndOp::fold(ArrayRef<Attribute> operands) {
+  if (getNumOperands() != 1) return {};
+  Operation *def = getOperand(0).getDefiningOp();
+  if (def && def == getOperation()->getPrevNode() &&
+      def->hasTrait<OpTrait::ControlOpTrait>())
+    return getOperand(0);
+  return {};
+}
+
+namespace {
+/// drop duplicate signals; a control_and also drops local starts, a start
+/// left without uses is erased with it, the last signal is always kept
+template <typename OpTy>
+struct SimplifySignals : public OpRewritePattern<OpTy> {
+  using OpRewritePattern<OpTy>::OpRewritePattern;
+
+  LogicalResult matchAndRewrite(OpTy op,
+                                PatternRewriter &rewriter) const override {
+    Operation *operation = op.getOperation();
+    bool isAnd = isa<ControlAndOp>(operation);
+    SmallVector<Value, 4> signals;
+    Value start;
+    for (Value in : operation->getOperands()) {
+      if (llvm::is_contained(signals, in)) continue;
+      if (isAnd && isLocalStart(in, operation)) {
+        if (!start) start = in;
+        continue;
+      }
+      signals.push_back(in);
+    }
+    // a control_and of starts only
+    if (signals.empty() && start)
+      signals.push_back(start);
+    if (signals.size() == operation->getNumOperands())
+      return failure();
+    rewriter.updateRootInPlace(operation, [&] { operation->setOperands(signals); });
+    return success();
+  }
+};
+
+/// drop duplicate signals and those an earlier await in the block waited
+/// for; an await left without signals takes no time and is erased
+struct SimplifyAwait : public OpRewritePattern<AwaitOp> {
+  using OpRewritePattern<AwaitOp>::OpRewritePattern;
+
+  LogicalResult matchAndRewrite(AwaitOp op,
+                                PatternRewriter &rewriter) const override {
+    Operation *operation = op.getOperation();
+    llvm::DenseSet<Value> awaited;
+    for (Operation *prev = operation->getPrevNode(); prev; prev = prev->getPrevNode())
+      if (isa<AwaitOp>(prev))
+        awaited.insert(prev->operand_begin(), prev->operand_end());
+    SmallVector<Value, 4> signals;
+    for (Value in : operation->getOperands())
+      if (!awaited.count(in) && !llvm::is_contained(signals, in))
+        signals.push_back(in);
+    if (signals.empty()) {
+      rewriter.eraseOp(operation);
+      return success();
+    }
+    if (signals.size() == operation->getNumOperands())
+      return failure();
+    rewriter.updateRootInPlace(operation, [&] { operation->setOperands(signals); });
+    return success();
+  }
+};
+} // namespace
+
+void ControlAndOp::getCanonicalizationPatterns(
+    OwningRewritePatternList &results, MLIRContext *context) {
+  results.insert<SimplifySignals<ControlAndOp>>(context);
+}
+
+void ControlOrOp::getCanonicalizationPatterns(
+    OwningRewritePatternList &results, MLIRContext *context) {
+  results.insert<SimplifySignals<ControlOrOp>>(context);
+}
+
+void AwaitOp::getCanonicalizationPatterns(
+    OwningRewritePatternList &results, MLIRContext *context) {
+  results.insert<SimplifyAwait>(context);
+}
 
 namespace xilinx {
 namespace equeue {
@@ -0,0 +1,370 @@
+//===- Interpreter.cpp ------------------------------------------*- C++ -*-===//
+//
+// This file is licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "EQueue/Interpreter.h"
+
+#include "mlir/Dialect/Affine/IR/AffineOps.h"
+#include "mlir/Dialect/StandardOps/IR/Ops.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/MathExtras.h"
+
+#include <algorithm>
+
+using namespace mlir;
+namespace acdc {
+
+static unsigned getIntWidth(Type type){
+  if (auto intType = type.dyn_cast<IntegerType>())
+    return intType.getWidth();
+  return 64;
+}
+/// integer results wrap around at the width of their type
+static int64_t wrap(int64_t value, Type type){
+  unsigned width = getIntWidth(type);
+  if (width >= 64) return value;
+  if (width == 1) return value & 1;
+  return llvm::SignExtend64(value, width);
+}
+
+void Interpreter::number(Block &block){
+  for (Operation &op : block){
+    for (Value result : op.getResults()){
+      slots.insert({result, registers.size()});
+      registers.push_back(Register());
+    }
+    for (Region &region : op.getRegions())
+      for (Block &inner : region){
+        for (Value arg : inner.getArguments()){
+          slots.insert({arg, registers.size()});
+          registers.push_back(Register());
+        }
+        number(inner);
+      }
+  }
+}
+
+void Interpreter::build(FuncOp &toplevel){
+  slots.clear();
+  registers.clear();
+  for (Block &block : *toplevel.getCallableRegion()){
+    for (Value arg : block.getArguments()){
+      slots.insert({arg, registers.size()});
+      registers.push_back(Register());
+    }
+    number(block);
+  }
+  defined.clear();
+  defined.resize(registers.size());
+  reported.clear();
+  failed = false;
+}
+
+void Interpreter::restore(ArrayRef<Value> values, ArrayRef<uint64_t> registerOf,
+                          unsigned numRegisters){
+  slots.clear();
+  slots.reserve(values.size());
+  for (unsigned i = 0; i < values.size(); i++)
+    if (registerOf[i] < numRegisters)
+      slots.insert({values[i], registerOf[i]});
+  registers.assign(numRegisters, Register());
+  defined.clear();
+  defined.resize(registers.size());
+  reported.clear();
+  failed = false;
+}
+
+unsigned Interpreter::getRegister(Value v) const {
+  auto it = slots.find(v);
+  return it == slots.end() ? registers.size() : it->second;
+}
+
+bool Interpreter::read(Value v, Register &r){
+  auto it = slots.find(v);
+  if (it == slots.end()) return false;
+  if (!defined[it->second]){
+    Operation *op = v.getDefiningOp();
+    if (!op || !evaluate(op)) return false;
+  }
+  r = registers[it->second];
+  return true;
+}
+
+void Interpreter::write(Value v, Register r){
+  auto it = slots.find(v);
+  if (it == slots.end()) return;
+  registers[it->second] = r;
+  defined.set(it->second);
+}
+
+Snapshot Interpreter::capture(ValueRange vs){
+  Snapshot values;
+  for (Value v : vs){
+    Register r;
+    if (read(v, r)) values.push_back(r);
+    else values.push_back(llvm::None);
+  }
+  return values;
+}
+
+void Interpreter::bind(ValueRange vs, const Snapshot &values){
+  for (unsigned i = 0; i < vs.size() && i < values.size(); i++){
+    if (values[i]){
+      write(vs[i], *values[i]);
+      continue;
+    }
+    // read on demand reports it as unknown
+    auto it = slots.find(vs[i]);
+    if (it != slots.end()) defined.reset(it->second);
+  }
+}
+
+/// read all values before writing any, a yield may swap iteration arguments
+void Interpreter::copy(ValueRange from, ValueRange to){
+  llvm::SmallVector<Register, 4> values(from.size());
+  llvm::SmallVector<bool, 4> known(from.size());
+  for (unsigned i = 0; i < from.size(); i++)
+    known[i] = read(from[i], values[i]);
+  for (unsigned i = 0; i < to.size() && i < from.size(); i++)
+    if (known[i]) write(to[i], values[i]);
+}
+
+bool Interpreter::evaluateAffine(AffineExpr expr, ValueRange dims,
+                                 ValueRange syms, int64_t &result){
+  Register r;
+  switch (expr.getKind()){
+  case AffineExprKind::Constant:
+    result = expr.cast<AffineConstantExpr>().getValue();
+    return true;
+  case AffineExprKind::DimId:
+    if (!read(dims[expr.cast<AffineDimExpr>().getPosition()], r)) return false;
+    result = r.i;
+    return true;
+  case AffineExprKind::SymbolId:
+    if (!read(syms[expr.cast<AffineSymbolExpr>().getPosition()], r)) return false;
+    result = r.i;
+    return true;
+  default:
+    break;
+  }
+  auto bin = expr.cast<AffineBinaryOpExpr>();
+  int64_t lhs, rhs;
+  if (!evaluateAffine(bin.getLHS(), dims, syms, lhs) ||
+      !evaluateAffine(bin.getRHS(), dims, syms, rhs))
+    return false;
+  switch (expr.getKind()){
+  case AffineExprKind::Add:
+    result = lhs + rhs;
+    break;
+  case AffineExprKind::Mul:
+    result = lhs * rhs;
+    break;
+  case AffineExprKind::Mod:
+    result = rhs ? ((lhs % rhs) + rhs) % rhs : 0;
+    break;
+  case AffineExprKind::FloorDiv:
+    result = rhs ? (lhs >= 0 ? lhs / rhs : -((-lhs + rhs - 1) / rhs)) : 0;
+    break;
+  case AffineExprKind::CeilDiv:
+    result = rhs ? (lhs >= 0 ? (lhs + rhs - 1) / rhs : -(-lhs / rhs)) : 0;
+    break;
+  default:
+    llvm_unreachable("unknown affine expression");
+  }
+  return true;
+}
+
+/// the results of op from the registers of its operands, false for ops
+/// that are not arithmetic
+bool Interpreter::evaluate(Operation *op){
+  if (op->getNumResults() != 1 || !op->getResult(0).getType().isIntOrIndexOrFloat())
+    return false;
+  Register a, b, c, r;
+  if (auto Op = llvm::dyn_cast<ConstantOp>(op)){
+    if (auto attr = Op.getValue().dyn_cast<IntegerAttr>())
+      r.i = wrap(attr.getValue().getSExtValue(), attr.getType());
+    else if (auto attr = Op.getValue().dyn_cast<FloatAttr>())
+      r.f = attr.getValueAsDouble();
+    else
+      return false;
+    write(op->getResult(0), r);
+    return true;
+  }
+  if (llvm::isa<AffineApplyOp>(op) || llvm::isa<AffineMinOp>(op) ||
+      llvm::isa<AffineMaxOp>(op)){
+    auto map = op->getAttrOfType<AffineMapAttr>("map").getValue();
+    ValueRange operands = op->getOperands();
+    ValueRange dims = operands.take_front(map.getNumDims());
+    ValueRange syms = operands.drop_front(map.getNumDims());
+    for (unsigned i = 0; i < map.getNumResults(); i++){
+      int64_t value;
+      if (!evaluateAffine(map.getResult(i), dims, syms, value)) return false;
+      if (i == 0 || (llvm::isa<AffineMinOp>(op) && value < r.i) ||
+          (llvm::isa<AffineMaxOp>(op) && value > r.i))
+        r.i = value;
+    }
+    write(op->getResult(0), r);
+    return true;
+  }
+  if (llvm::isa<SelectOp>(op)){
+    if (!read(op->getOperand(0), c) || !read(op->getOperand(1), a) ||
+        !read(op->getOperand(2), b))
+      return false;
+    write(op->getResult(0), c.i ? a : b);
+    return true;
+  }
+  // unary ops
+  if (op->getNumOperands() == 1 && op->getNumResults() == 1){
+    Type from = op->getOperand(0).getType();
+    Type to = op->getResult(0).getType();
+    if (!read(op->getOperand(0), a)) return false;
+    if (llvm::isa<IndexCastOp>(op) || llvm::isa<TruncateIOp>(op))
+      r.i = wrap(a.i, to);
+    else if (llvm::isa<SignExtendIOp>(op))
+      r.i = llvm::SignExtend64(a.i, getIntWidth(from));
+    else if (llvm::isa<ZeroExtendIOp>(op))
+      r.i = getIntWidth(from) >= 64 ? a.i : a.i & llvm::maskTrailingOnes<uint64_t>(getIntWidth(from));
+    else if (llvm::isa<SIToFPOp>(op))
+      r.f = double(a.i);
+    else
+      return false;
+    write(op->getResult(0), r);
+    return true;
+  }
+  if (op->getNumOperands() != 2 || op->getNumResults() != 1) return false;
+  // binary ops
+  Type type = op->getResult(0).getType();
+  if (!read(op->getOperand(0), a) || !read(op->getOperand(1), b)) return false;
+  // unsigned ops see the bits of the type only
+  uint64_t ua = a.i, ub = b.i;
+  if (getIntWidth(type) < 64){
+    ua &= llvm::maskTrailingOnes<uint64_t>(getIntWidth(type));
+    ub &= llvm::maskTrailingOnes<uint64_t>(getIntWidth(type));
+  }
+  if (llvm::isa<AddIOp>(op))
+    r.i = wrap(ua + ub, type);
+  else if (llvm::isa<SubIOp>(op))
+    r.i = wrap(ua - ub, type);
+  else if (llvm::isa<MulIOp>(op))
+    r.i = wrap(ua * ub, type);
+  else if (llvm::isa<SignedDivIOp>(op))
+    r.i = b.i ? wrap(a.i / b.i, type) : 0;
+  else if (llvm::isa<SignedRemIOp>(op))
+    r.i = b.i ? wrap(a.i % b.i, type) : 0;
+  else if (llvm::isa<UnsignedDivIOp>(op))
+    r.i = ub ? wrap(ua / ub, type) : 0;
+  else if (llvm::isa<UnsignedRemIOp>(op))
+    r.i = ub ? wrap(ua % ub, type) : 0;
+  else if (llvm::isa<AndOp>(op))
+    r.i = a.i & b.i;
+  else if (llvm::isa<OrOp>(op))
+    r.i = a.i | b.i;
+  else if (llvm::isa<XOrOp>(op))
+    r.i = wrap(a.i ^ b.i, type);
+  else if (llvm::isa<ShiftLeftOp>(op))
+    r.i = ub < 64 ? wrap(ua << ub, type) : 0;
+  else if (llvm::isa<SignedShiftRightOp>(op))
+    r.i = a.i >> std::min(ub, uint64_t(63));
+  else if (llvm::isa<UnsignedShiftRightOp>(op))
+    r.i = ub < 64 ? wrap(ua >> ub, type) : 0;
+  else if (llvm::isa<AddFOp>(op))
+    r.f = a.f + b.f;
+  else if (llvm::isa<SubFOp>(op))
+    r.f = a.f - b.f;
+  else if (llvm::isa<MulFOp>(op))
+    r.f = a.f * b.f;
+  else if (llvm::isa<DivFOp>(op))
+    r.f = a.f / b.f;
+  else if (auto Op = llvm::dyn_cast<CmpIOp>(op)){
+    switch (Op.getPredicate()){
+    case CmpIPredicate::eq:  r.i = a.i == b.i; break;
+    case CmpIPredicate::ne:  r.i = a.i != b.i; break;
+    case CmpIPredicate::slt: r.i = a.i < b.i; break;
+    case CmpIPredicate::sle: r.i = a.i <= b.i; break;
+    case CmpIPredicate::sgt: r.i = a.i > b.i; break;
+    case CmpIPredicate::sge: r.i = a.i >= b.i; break;
+    case CmpIPredicate::ult: r.i = ua < ub; break;
+    case CmpIPredicate::ule: r.i = ua <= ub; break;
+    case CmpIPredicate::ugt: r.i = ua > ub; break;
+    case CmpIPredicate::uge: r.i = ua >= ub; break;
+    }
+  }
+  else
+    return false;
+  write(op->getResult(0), r);
+  return true;
+}
+
+bool Interpreter::execute(Operation *op){
+  return evaluate(op);
+}
+
+llvm::Optional<int64_t> Interpreter::tryGetInt(Value v){
+  Register r;
+  if (!read(v, r)) return llvm::None;
+  return r.i;
+}
+
+void Interpreter::reportUnknown(Value v, Operation *user){
+  failed = true;
+  if (!reported.insert(v).second) return;
+  unsigned operand = 0;
+  while (operand < user->getNumOperands() && user->getOperand(operand) != v)
+    operand++;
+  auto diag = user->emitError("operand #") << operand
+    << " is not known to the simulator";
+  diag.attachNote(v.getLoc()) << "the simulator cannot compute this value";
+}
+
+int64_t Interpreter::getInt(Value v, Operation *user){
+  Register r;
+  if (read(v, r)) return r.i;
+  reportUnknown(v, user);
+  return 0;
+}
+
+double Interpreter::getFloat(Value v, Operation *user){
+  Register r;
+  if (read(v, r)) return r.f;
+  reportUnknown(v, user);
+  return 0.0;
+}
+
+llvm::Optional<int64_t> Interpreter::getTripCount(scf::ForOp forOp){
+  auto lb = tryGetInt(forOp.lowerBound());
+  auto ub = tryGetInt(forOp.upperBound());
+  auto step = tryGetInt(forOp.step());
+  if (!lb || !ub || !step) return llvm::None;
+  if (*step <= 0 || *ub <= *lb) return int64_t(0);
+  return (*ub - *lb + *step - 1) / *step;
+}
+
+void Interpreter::enterLoop(scf::ForOp forOp){
+  // all bounds are needed to count the iterations
+  getInt(forOp.upperBound(), forOp);
+  getInt(forOp.step(), forOp);
+  Register r;
+  r.i = getInt(forOp.lowerBound(), forOp);
+  write(forOp.getInductionVar(), r);
+  copy(forOp.getIterOperands(), forOp.getRegionIterArgs());
+  auto trip = getTripCount(forOp);
+  if (trip && !*trip)
+    copy(forOp.getIterOperands(), forOp.getResults());
+}
+
+void Interpreter::nextIteration(scf::ForOp forOp){
+  copy(forOp.getBody()->getTerminator()->getOperands(), forOp.getRegionIterArgs());
+  Register r;
+  r.i = getInt(forOp.getInductionVar(), forOp) + getInt(forOp.step(), forOp);
+  write(forOp.getInductionVar(), r);
+}
+
+void Interpreter::exitLoop(scf::ForOp forOp){
+  copy(forOp.getBody()->getTerminator()->getOperands(), forOp.getResults());
+}
+
+} // namespace acdc
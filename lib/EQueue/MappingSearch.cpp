@@ -0,0 +1,365 @@
+//===- MappingSearch.cpp ----------------------------------------*- C++ -*-===//
+//
+// This file is licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "EQueue/MappingSearch.h"
+
+#include "EQueue/CommandProcessor.h"
+#include "EQueue/EQueueDialect.h"
+#include "EQueue/EQueueStructs.h"
+
+#include "mlir/Dialect/Affine/IR/AffineOps.h"
+#include "mlir/Dialect/SCF/SCF.h"
+#include "mlir/Dialect/StandardOps/IR/Ops.h"
+#include "mlir/IR/Builders.h"
+#include "mlir/IR/Function.h"
+#include "mlir/IR/Verifier.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <sstream>
+#include <tuple>
+
+using namespace mlir;
+namespace acdc {
+
+namespace {
+/// tile counts and lines of one tile of a mapping
+struct Tiles {
+  int64_t nh, nw, nk;
+  // the input tile has a halo of the filter size
+  int64_t act, weight, out;
+  // per output line
+  int64_t macs;
+
+  Tiles(const ConvLayer &l, const Mapping &m)
+    : nh(l.outH() / m.th), nw(l.outW() / m.tw), nk(l.K / m.tk),
+      act(l.C * (m.th + l.R - 1) * (m.tw + l.S - 1)),
+      weight(m.tk * l.C * l.R * l.S), out(m.tk * m.th * m.tw),
+      macs(l.C * l.R * l.S) {}
+  int64_t count(char d) const {
+    return d == 'h' ? nh : d == 'w' ? nw : nk;
+  }
+};
+} // namespace
+
+static std::vector<int64_t> divisors(int64_t n){
+  std::vector<int64_t> result;
+  for (int64_t d = 1; d <= n; d++)
+    if (n % d == 0) result.push_back(d);
+  return result;
+}
+
+/// loop of m in which a tile is copied: the input tile changes with h and w,
+/// the weights with k
+static unsigned actLevel(const Mapping &m){
+  return std::max(m.order.find('h'), m.order.find('w'));
+}
+static unsigned weightLevel(const Mapping &m){
+  return m.order.find('k');
+}
+
+std::string Mapping::str() const {
+  return "tiles " + std::to_string(th) + "x" + std::to_string(tw) + "x" +
+    std::to_string(tk) + " order " + order + " on " + std::to_string(cores) +
+    (cores == 1 ? " core" : " cores");
+}
+
+std::vector<Mapping> MappingSearch::enumerate() const {
+  std::vector<Mapping> result;
+  if (layer.outH() < 1 || layer.outW() < 1 || layer.K < 1 || !hierarchy.cores)
+    return result;
+  for (int64_t th : divisors(layer.outH()))
+    for (int64_t tw : divisors(layer.outW()))
+      for (int64_t tk : divisors(layer.K)) {
+        Mapping m;
+        m.th = th;
+        m.tw = tw;
+        m.tk = tk;
+        Tiles t(layer, m);
+        if (t.act + t.weight + t.out > hierarchy.localLines) continue;
+        std::string order = "hkw";
+        do {
+          m.order = order;
+          m.cores = std::min<int64_t>(hierarchy.cores, t.count(order[0]));
+          result.push_back(m);
+        } while (std::next_permutation(order.begin(), order.end()));
+      }
+  return result;
+}
+
+uint64_t MappingSearch::estimate(const Mapping &m) const {
+  Tiles t(layer, m);
+  int64_t sharedLines = t.nh * t.nw * t.act + t.nk * t.weight +
+    layer.K * layer.outH() * layer.outW();
+  xilinx::equeue::SRAM shared(0, sharedLines, "f32");
+  xilinx::equeue::SRAM local(1, hierarchy.localLines, "f32");
+  xilinx::equeue::DMA dma(2);
+  auto copy = [&](xilinx::equeue::Memory &src, int64_t lines) -> uint64_t {
+    return std::max({uint64_t(shared.cycles), uint64_t(local.cycles),
+      uint64_t(dma.getTransferCycles(lines * src.total_size))});
+  };
+  // two reads, mulf and addf per MAC, a write per output
+  uint64_t compute = t.out * (t.macs * (2 * local.cycles + 2) + local.cycles);
+  uint64_t actCopy = copy(shared, t.act);
+  uint64_t weightCopy = copy(shared, t.weight);
+  uint64_t outCopy = copy(local, t.out);
+
+  // iterations of the body of a loop, on the busiest core and on all
+  auto iterations = [&](unsigned level, bool perCore){
+    uint64_t n = t.count(m.order[0]);
+    if (perCore) n = (n + m.cores - 1) / m.cores;
+    for (unsigned i = 1; i <= level; i++)
+      n *= t.count(m.order[i]);
+    return n;
+  };
+  auto busy = [&](bool perCore){
+    return iterations(actLevel(m), perCore) * actCopy +
+      iterations(weightLevel(m), perCore) * weightCopy +
+      iterations(2, perCore) * outCopy;
+  };
+  // a core runs its tiles one after the other, all copies share the DMA
+  return std::max(busy(true) + iterations(2, true) * compute, busy(false));
+}
+
+/// an equeue op built generically, with the operands, result types and
+/// attributes its parser would give it
+static Operation *create(OpBuilder &b, StringRef name, ValueRange operands,
+                         ArrayRef<Type> types,
+                         ArrayRef<NamedAttribute> attrs = {}){
+  OperationState state(b.getUnknownLoc(), name);
+  state.addOperands(operands);
+  state.addTypes(types);
+  state.addAttributes(attrs);
+  return b.createOperation(state);
+}
+
+/// a launch on device once start fires, body fills its block from the
+/// region arguments before the equeue.return; returns the end signal
+static Value launch(OpBuilder &b, Value start, Value device, ValueRange operands,
+                    llvm::function_ref<void(ValueRange)> body){
+  OperationState state(b.getUnknownLoc(), "equeue.launch");
+  state.addOperands({start, device});
+  state.addOperands(operands);
+  state.addTypes(xilinx::equeue::EQueueSignalType::get(b.getContext()));
+  state.addRegion();
+  Operation *op = b.createOperation(state);
+  Block *block = new Block();
+  op->getRegion(0).push_back(block);
+  SmallVector<Type, 8> types;
+  for (Value v : operands)
+    types.push_back(v.getType());
+  block->addArguments(types);
+  OpBuilder::InsertionGuard guard(b);
+  b.setInsertionPointToStart(block);
+  body(block->getArguments());
+  create(b, "equeue.return", {}, {});
+  return op->getResult(0);
+}
+
+mlir::OwningModuleRef MappingSearch::generate(MLIRContext &context,
+                                              const Mapping &m) const {
+  Tiles t(layer, m);
+  int64_t actLines = t.nh * t.nw * t.act;
+  int64_t weightLines = t.nk * t.weight;
+  int64_t outLines = layer.K * layer.outH() * layer.outW();
+
+  OpBuilder b(&context);
+  Location loc = b.getUnknownLoc();
+  Type i32 = b.getI32Type();
+  FloatType f32 = b.getF32Type();
+  Type signal = xilinx::equeue::EQueueSignalType::get(&context);
+  auto container = [&](int64_t lines) -> Type {
+    return xilinx::equeue::EQueueContainerType::get(
+      RankedTensorType::get({lines}, f32), i32);
+  };
+  auto constant = [&](int64_t v) -> Value {
+    return b.create<ConstantIndexOp>(loc, v);
+  };
+  auto createMem = [&](int64_t lines) -> Value {
+    return create(b, "equeue.create_mem", {}, {i32},
+      {b.getNamedAttr("shape", b.getI64TensorAttr({lines})),
+       b.getNamedAttr("data", b.getStringAttr("f32")),
+       b.getNamedAttr("type", b.getStringAttr("SRAM"))})->getResult(0);
+  };
+  auto createProc = [&](StringRef type) -> Value {
+    return create(b, "equeue.create_proc", {}, {i32},
+      {b.getNamedAttr("type", b.getStringAttr(type))})->getResult(0);
+  };
+  auto join = [&](ArrayRef<Value> signals) -> Value {
+    if (signals.size() == 1) return signals[0];
+    return create(b, "equeue.control_and", signals, {signal})->getResult(0);
+  };
+  auto alloc = [&](Value mem, int64_t lines) -> Value {
+    return create(b, "equeue.alloc", {mem}, {container(lines)},
+      {b.getNamedAttr("shape", b.getI64TensorAttr({lines})),
+       b.getNamedAttr("data", b.getStringAttr("f32"))})->getResult(0);
+  };
+  auto affine = [&](AffineExpr expr, unsigned dims, ValueRange operands) -> Value {
+    return b.create<AffineApplyOp>(loc, AffineMap::get(dims, 0, {expr}, &context),
+                                   operands);
+  };
+  AffineExpr d0 = b.getAffineDimExpr(0), d1 = b.getAffineDimExpr(1),
+             d2 = b.getAffineDimExpr(2);
+
+  mlir::OwningModuleRef module(ModuleOp::create(loc));
+  auto func = FuncOp::create(loc, "graph", b.getFunctionType({}, {}));
+  module->push_back(func);
+  b.setInsertionPointToStart(func.addEntryBlock());
+
+  Value shared = createMem(actLines + weightLines + outLines);
+  Value host = createProc("ARMr5");
+  Value dma = create(b, "equeue.create_dma", {}, {i32})->getResult(0);
+  SmallVector<Value, 8> comps = {host, dma, shared};
+  SmallVector<Value, 8> operands = {dma, shared};
+  for (unsigned p = 0; p < m.cores; p++) {
+    Value mem = createMem(hierarchy.localLines);
+    Value core = createProc("AIEngine");
+    comps.push_back(create(b, "equeue.create_comp", {mem, core}, {i32})->getResult(0));
+    operands.push_back(mem);
+    operands.push_back(core);
+  }
+  create(b, "equeue.create_comp", comps, {i32});
+  Value start = create(b, "equeue.control_start", {}, {signal})->getResult(0);
+
+  Value done = launch(b, start, host, operands, [&](ValueRange locals){
+    Value dmaL = locals[0], sharedL = locals[1];
+    // the data tile by tile, input tiles with their halo
+    Value act = alloc(sharedL, actLines);
+    Value weight = alloc(sharedL, weightLines);
+    Value out = alloc(sharedL, outLines);
+    SmallVector<Value, 16> buffers = {act, weight, out};
+    for (unsigned p = 0; p < m.cores; p++) {
+      Value memL = locals[2 + 2 * p];
+      buffers.push_back(alloc(memL, t.act));
+      buffers.push_back(alloc(memL, t.weight));
+      buffers.push_back(alloc(memL, t.out));
+    }
+    Value go = create(b, "equeue.control_start", {}, {signal})->getResult(0);
+    auto copy = [&](Value start, Value src, Value dest, Value offset) -> Value {
+      return create(b, "equeue.memcpy", {start, src, dest, dmaL, offset},
+                    {signal})->getResult(0);
+    };
+
+    SmallVector<Value, 8> ends;
+    for (unsigned p = 0; p < m.cores; p++) {
+      Value coreL = locals[3 + 2 * p];
+      Value actP = buffers[3 + 3 * p], weightP = buffers[4 + 3 * p],
+            outP = buffers[5 + 3 * p];
+      std::map<char, Value> ivs;
+      // the tile of core p computed after start, returns its end signal
+      auto compute = [&](Value start){
+        Value computed = launch(b, start, coreL, {actP, weightP, outP},
+                                [&](ValueRange tiles){
+          Value z = constant(0);
+          Value one = constant(1);
+          Value outputs = constant(t.out);
+          Value macs = constant(t.macs);
+          auto outer = b.create<scf::ForOp>(loc, z, outputs, one);
+          OpBuilder::InsertionGuard guard(b);
+          b.setInsertionPointToStart(outer.getBody());
+          Value f0 = b.create<ConstantFloatOp>(loc, llvm::APFloat(0.0f), f32);
+          auto inner = b.create<scf::ForOp>(loc, z, macs, one, ValueRange{f0});
+          {
+            OpBuilder::InsertionGuard guard(b);
+            b.setInsertionPointToStart(inner.getBody());
+            Value j = inner.getInductionVar();
+            Value a = create(b, "equeue.read", {tiles[0], j}, {f32})->getResult(0);
+            Value w = create(b, "equeue.read", {tiles[1], j}, {f32})->getResult(0);
+            Value product = b.create<MulFOp>(loc, a, w);
+            Value sum = b.create<AddFOp>(loc, inner.getRegionIterArgs()[0], product);
+            b.create<scf::YieldOp>(loc, ValueRange{sum});
+          }
+          create(b, "equeue.write",
+                 {inner.getResult(0), tiles[2], outer.getInductionVar()}, {});
+        });
+        Value offset = affine(((d0 * t.nh + d1) * t.nw + d2) * t.out, 3,
+                              {ivs['k'], ivs['h'], ivs['w']});
+        return copy(computed, outP, out, offset);
+      };
+      // the loop at level and the ones inside it, started by init
+      std::function<Value(unsigned, Value)> loop;
+      loop = [&](unsigned level, Value init) -> Value {
+        char d = m.order[level];
+        Value lb = constant(level ? 0 : p);
+        Value ub = constant(t.count(d));
+        Value step = constant(level ? 1 : m.cores);
+        auto forOp = b.create<scf::ForOp>(loc, lb, ub, step, ValueRange{init});
+        OpBuilder::InsertionGuard guard(b);
+        b.setInsertionPointToStart(forOp.getBody());
+        ivs[d] = forOp.getInductionVar();
+        Value arg = forOp.getRegionIterArgs()[0];
+        // the tiles that change with this loop, copied once the previous
+        // iteration is done with the buffers
+        SmallVector<Value, 2> ready;
+        if (level == actLevel(m)) {
+          Value offset = affine((d0 * t.nw + d1) * t.act, 2, {ivs['h'], ivs['w']});
+          ready.push_back(copy(arg, act, actP, offset));
+        }
+        if (level == weightLevel(m)) {
+          Value offset = affine(d0 * t.weight, 1, {ivs['k']});
+          ready.push_back(copy(arg, weight, weightP, offset));
+        }
+        Value start = ready.empty() ? arg : join(ready);
+        Value last = level < 2 ? loop(level + 1, start) : compute(start);
+        b.create<scf::YieldOp>(loc, ValueRange{last});
+        return forOp.getResult(0);
+      };
+      ends.push_back(loop(0, go));
+    }
+    create(b, "equeue.await", {join(ends)}, {});
+    create(b, "equeue.dealloc", buffers, {});
+  });
+  create(b, "equeue.await", {done}, {});
+  b.create<ReturnOp>(loc);
+  return module;
+}
+
+std::vector<Mapping> MappingSearch::search(mlir::MLIRContext &context,
+                                           unsigned keep, unsigned threads) const {
+  auto candidates = enumerate();
+  for (auto &m : candidates)
+    m.estimate = estimate(m);
+  std::stable_sort(candidates.begin(), candidates.end(),
+    [](const Mapping &a, const Mapping &b){ return a.estimate < b.estimate; });
+
+  unsigned survivors = std::min<size_t>(keep, candidates.size());
+  llvm::ThreadPool pool(llvm::hardware_concurrency(threads));
+  for (unsigned i = 0; i < survivors; i++)
+    pool.async([&, i] {
+      Mapping &m = candidates[i];
+      m.simulated = true;
+      m.program = std::make_shared<mlir::OwningModuleRef>(generate(context, m));
+      ModuleOp module = m.program->get();
+      if (mlir::failed(mlir::verify(module))) {
+        m.failed = true;
+        return;
+      }
+      std::stringstream traceStream;
+      CommandProcessor proc(traceStream);
+      proc.setStatsStream(llvm::nulls());
+      m.failed = mlir::failed(proc.run(module));
+      m.latency = proc.getLatency();
+      m.trace = traceStream.str();
+    });
+  pool.wait();
+
+  // a mapping that does not simulate, e.g. out of memory, ranks after the
+  // simulated ones and before the pruned ones
+  auto rank = [](const Mapping &m){
+    return std::make_tuple(!m.simulated ? 2 : m.failed ? 1 : 0,
+                           m.simulated && !m.failed ? m.latency : m.estimate);
+  };
+  std::stable_sort(candidates.begin(), candidates.end(),
+    [&](const Mapping &a, const Mapping &b){ return rank(a) < rank(b); });
+  return candidates;
+}
+
+} // namespace acdc
@@ -0,0 +1,67 @@
+//===- SimulatePass.cpp -----------------------------------------*- C++ -*-===//
+//
+// This file is licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "EQueue/EQueuePasses.h"
+
+#include "mlir/IR/Attributes.h"
+#include "mlir/IR/Builders.h"
+#include "mlir/IR/Function.h"
+
+#include <sstream>
+
+using namespace mlir;
+namespace xilinx {
+namespace equeue {
+
+bool SimulationAnalysis::isEntry(FuncOp func){
+  return func.getName() == "graph" || func.getAttr("equeue.entry");
+}
+
+SimulationAnalysis::SimulationAnalysis(Operation *op) : simulated(false){
+  auto func = llvm::dyn_cast<FuncOp>(op);
+  if (!func || func.isExternal() || !isEntry(func)) return;
+  auto seed = func.getAttrOfType<IntegerAttr>("equeue.seed");
+  std::ostream nullStream(nullptr);
+  acdc::CommandProcessor proc(nullStream, false, seed ? seed.getInt() : 1);
+  result = proc.simulate(func);
+  simulated = true;
+}
+
+namespace {
+struct SimulatePass : public PassWrapper<SimulatePass, FunctionPass> {
+  void runOnFunction() override {
+    FuncOp func = getFunction();
+    // attributes do not change the result
+    markAllAnalysesPreserved();
+    auto &sim = getAnalysis<SimulationAnalysis>();
+    if (!sim.simulated) return;
+
+    Builder builder(func.getContext());
+    func.setAttr("equeue.latency", builder.getI64IntegerAttr(sim.result.latency));
+    SmallVector<NamedAttribute, 8> util;
+    for (auto &u : sim.result.utilization)
+      util.push_back(builder.getNamedAttr(u.first, builder.getF64FloatAttr(u.second)));
+    func.setAttr("equeue.utilization", builder.getDictionaryAttr(util));
+    if (sim.result.failed)
+      signalPassFailure();
+  }
+};
+} // namespace
+
+std::unique_ptr<Pass> createSimulatePass(){
+  return std::make_unique<SimulatePass>();
+}
+
+void registerEQueuePasses(){
+  PassRegistration<SimulatePass>("equeue-simulate",
+    "Simulate entry functions and attach their latency and utilization");
+  registerDoubleBufferPass();
+}
+
+} // namespace equeue
+} // namespace xilinx
@@ -0,0 +1,47 @@
+// RUN: equeue-opt %s -generate-input-file=false -stats -json %t.json | FileCheck %s
+
+// The same 16 lines under each policy, the host allocates and frees in order.
+// - bump: freeing b leaves a hole below c, d goes above c. With 12 lines in
+//   use the 4 free lines are all in the hole, none at the top.
+// - freelist: d takes the hole of b (first fit). Freeing a leaves two holes
+//   of 4 lines, half of the free lines outside the largest one; freeing d
+//   and c merges everything back.
+// - buddy: a takes 4 lines for 3 and splits the rest into blocks of 4 and 8,
+//   a third of the free lines outside the largest block. b takes 8 lines for
+//   5. Freeing a merges it with its free buddy at line 4, freeing b merges
+//   the halves back into the 16 lines e needs.
+// CHECK: memory allocator capacity peak in use fragmentation
+// CHECK-NEXT: SRAM_0 bump 16 12 0 100.0%
+// CHECK-NEXT: SRAM_1 freelist 16 12 0 50.0%
+// CHECK-NEXT: SRAM_2 buddy 16 16 0 33.3%
+module {
+	func @graph() {
+		%bump = equeue.create_mem [16], f32, SRAM {allocator = "bump"}
+		%list = equeue.create_mem [16], f32, SRAM {allocator = "freelist"}
+		%buddy = equeue.create_mem [16], f32, SRAM {allocator = "buddy"}
+
+		%a0 = equeue.alloc %bump, [4], f32 : !equeue.container<tensor<4xf32>, i32>
+		%b0 = equeue.alloc %bump, [4], f32 : !equeue.container<tensor<4xf32>, i32>
+		%c0 = equeue.alloc %bump, [4], f32 : !equeue.container<tensor<4xf32>, i32>
+		equeue.dealloc %b0 : !equeue.container<tensor<4xf32>, i32>
+		%d0 = equeue.alloc %bump, [4], f32 : !equeue.container<tensor<4xf32>, i32>
+		equeue.dealloc %a0, %c0, %d0 : !equeue.container<tensor<4xf32>, i32>, !equeue.container<tensor<4xf32>, i32>, !equeue.container<tensor<4xf32>, i32>
+
+		%a1 = equeue.alloc %list, [4], f32 : !equeue.container<tensor<4xf32>, i32>
+		%b1 = equeue.alloc %list, [4], f32 : !equeue.container<tensor<4xf32>, i32>
+		%c1 = equeue.alloc %list, [4], f32 : !equeue.container<tensor<4xf32>, i32>
+		equeue.dealloc %b1 : !equeue.container<tensor<4xf32>, i32>
+		%d1 = equeue.alloc %list, [4], f32 : !equeue.container<tensor<4xf32>, i32>
+		equeue.dealloc %a1 : !equeue.container<tensor<4xf32>, i32>
+		equeue.dealloc %d1 : !equeue.container<tensor<4xf32>, i32>
+		equeue.dealloc %c1 : !equeue.container<tensor<4xf32>, i32>
+
+		%a2 = equeue.alloc %buddy, [3], f32 : !equeue.container<tensor<3xf32>, i32>
+		%b2 = equeue.alloc %buddy, [5], f32 : !equeue.container<tensor<5xf32>, i32>
+		equeue.dealloc %a2 : !equeue.container<tensor<3xf32>, i32>
+		equeue.dealloc %b2 : !equeue.container<tensor<5xf32>, i32>
+		%e2 = equeue.alloc %buddy, [16], f32 : !equeue.container<tensor<16xf32>, i32>
+		equeue.dealloc %e2 : !equeue.container<tensor<16xf32>, i32>
+		return
+	}
+}
@@ -0,0 +1,19 @@
+// RUN: not equeue-opt %s -generate-input-file=false -json %t.json 2>&1 | FileCheck %s
+
+// The 12 free lines of the freelist memory are in two holes, the largest of
+// 8 lines. The buddy memory rounds 9 lines up to all 16.
+module {
+	func @graph() {
+		%list = equeue.create_mem [16], f32, SRAM
+		%buddy = equeue.create_mem [16], f32, SRAM {allocator = "buddy"}
+		%a = equeue.alloc %list, [8], f32 : !equeue.container<tensor<8xf32>, i32>
+		%b = equeue.alloc %list, [4], f32 : !equeue.container<tensor<4xf32>, i32>
+		equeue.dealloc %a : !equeue.container<tensor<8xf32>, i32>
+		// CHECK: error: cannot allocate 10 lines on SRAM_0: 4 of 16 lines in use, largest free block 8
+		%c = equeue.alloc %list, [10], f32 : !equeue.container<tensor<10xf32>, i32>
+		%d = equeue.alloc %buddy, [9], f32 : !equeue.container<tensor<9xf32>, i32>
+		// CHECK: error: cannot allocate 1 lines on SRAM_1: 16 of 16 lines in use, largest free block 0
+		%e = equeue.alloc %buddy, [1], f32 : !equeue.container<tensor<1xf32>, i32>
+		return
+	}
+}
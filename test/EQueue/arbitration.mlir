@@ -0,0 +1,75 @@
+// RUN: equeue-opt %s -generate-input-file=false -stats -json %t.json | FileCheck %s --check-prefix=FIFO
+// RUN: sed 's/"fifo"/"round_robin"/' %s | equeue-opt -generate-input-file=false -stats -json %t.json | FileCheck %s --check-prefix=RR
+// RUN: sed 's/"fifo"/"priority"/' %s | equeue-opt -generate-input-file=false -stats -json %t.json | FileCheck %s --check-prefix=PRIO
+// RUN: sed 's/"fifo"/"weighted"/' %s | equeue-opt -generate-input-file=false -stats -json %t.json | FileCheck %s --check-prefix=WEIGHTED
+
+// ARMr5_1 and ARMr5_2 push two launches each into the single-entry queue of
+// ARMr5_0, ARMr5_3 one. All five requests arrive at time 1 or when the
+// first launch of their requester is granted. A grant frees the queue when
+// ARMr5_0 starts the launch, so the first two are granted at time 1 and the
+// others at times 2, 3 and 4, one per body of a cycle.
+// - fifo: by arrival, then requester: 1, 1, 2, 3 (arrived at 1), 2.
+// - round_robin: the requester after the last one granted: 1, 2, 3, 1, 2.
+// - priority: ARMr5_3 (2) first, then ARMr5_2 (1), then ARMr5_1 (0).
+// - weighted: least grants per weight, ties by arrival: 1, 2, 3, then
+//   ARMr5_2 of weight 2 before ARMr5_1, which has as many grants.
+// FIFO: arbiter requester policy grants avg wait max wait
+// FIFO-NEXT: ARMr5_0 ARMr5_1 fifo 2 0.0 0
+// FIFO-NEXT: ARMr5_0 ARMr5_2 fifo 2 1.5 2
+// FIFO-NEXT: ARMr5_0 ARMr5_3 fifo 1 2.0 2
+// RR: arbiter requester policy grants avg wait max wait
+// RR-NEXT: ARMr5_0 ARMr5_1 round_robin 2 1.0 2
+// RR-NEXT: ARMr5_0 ARMr5_2 round_robin 2 1.5 3
+// RR-NEXT: ARMr5_0 ARMr5_3 round_robin 1 1.0 1
+// PRIO: arbiter requester policy grants avg wait max wait
+// PRIO-NEXT: ARMr5_0 ARMr5_1 priority 2 1.5 2
+// PRIO-NEXT: ARMr5_0 ARMr5_2 priority 2 0.5 1
+// PRIO-NEXT: ARMr5_0 ARMr5_3 priority 1 0.0 0
+// WEIGHTED: arbiter requester policy grants avg wait max wait
+// WEIGHTED-NEXT: ARMr5_0 ARMr5_1 weighted 2 1.5 3
+// WEIGHTED-NEXT: ARMr5_0 ARMr5_2 weighted 2 1.0 2
+// WEIGHTED-NEXT: ARMr5_0 ARMr5_3 weighted 1 1.0 1
+module {
+	func @graph() {
+		%shared = equeue.create_proc ARMr5 {queue_depth = 1, arbitration = "fifo"}
+		%a = equeue.create_proc ARMr5
+		%b = equeue.create_proc ARMr5 {priority = 1, weight = 2}
+		%c = equeue.create_proc ARMr5 {priority = 2}
+		%start = "equeue.control_start"():()->!equeue.signal
+		%da = equeue.launch (%t, %s = %shared, %start : i32, !equeue.signal) in (%start, %a) {
+			%x = equeue.launch () in (%s, %t) {
+				%f = constant 1.0 : f32
+				%y = addf %f, %f : f32
+				"equeue.return"():()->()
+			}
+			%z = equeue.launch () in (%s, %t) {
+				%f = constant 1.0 : f32
+				%y = addf %f, %f : f32
+				"equeue.return"():()->()
+			}
+			"equeue.return"():()->()
+		}
+		%db = equeue.launch (%t, %s = %shared, %start : i32, !equeue.signal) in (%start, %b) {
+			%x = equeue.launch () in (%s, %t) {
+				%f = constant 1.0 : f32
+				%y = addf %f, %f : f32
+				"equeue.return"():()->()
+			}
+			%z = equeue.launch () in (%s, %t) {
+				%f = constant 1.0 : f32
+				%y = addf %f, %f : f32
+				"equeue.return"():()->()
+			}
+			"equeue.return"():()->()
+		}
+		%dc = equeue.launch (%t, %s = %shared, %start : i32, !equeue.signal) in (%start, %c) {
+			%x = equeue.launch () in (%s, %t) {
+				%f = constant 1.0 : f32
+				%y = addf %f, %f : f32
+				"equeue.return"():()->()
+			}
+			"equeue.return"():()->()
+		}
+		return
+	}
+}
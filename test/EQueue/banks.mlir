@@ -0,0 +1,37 @@
+// RUN: equeue-opt %s -generate-input-file=false -equeue-simulate -json %t.json | FileCheck %s
+
+// The host writes a whole 64-line buffer right after allocating it at time
+// 1. Unbanked, the write costs the 2 cycles of the SRAM; split over banks,
+// each port pays its share of those cycles, which rounds up to 1, so a
+// write without conflicts is never slower than on the unbanked memory.
+module {
+	// CHECK-LABEL: func @graph()
+	// CHECK-SAME: equeue.latency = 4 : i64
+	func @graph() {
+		%mem = equeue.create_mem [64], f32, SRAM
+		%buf = equeue.alloc %mem, [64], f32 : !equeue.container<tensor<64xf32>, i32>
+		%v = constant 0.0 : f32
+		"equeue.write"(%v, %buf) : (f32, !equeue.container<tensor<64xf32>, i32>) -> ()
+		return
+	}
+
+	// CHECK-LABEL: func @banked()
+	// CHECK-SAME: equeue.latency = 3 : i64
+	func @banked() attributes {equeue.entry} {
+		%mem = equeue.create_mem [64], f32, SRAM {banks = 4}
+		%buf = equeue.alloc %mem, [64], f32 : !equeue.container<tensor<64xf32>, i32>
+		%v = constant 0.0 : f32
+		"equeue.write"(%v, %buf) : (f32, !equeue.container<tensor<64xf32>, i32>) -> ()
+		return
+	}
+
+	// CHECK-LABEL: func @ported()
+	// CHECK-SAME: equeue.latency = 3 : i64
+	func @ported() attributes {equeue.entry} {
+		%mem = equeue.create_mem [64], f32, SRAM {banks = 2, ports_per_bank = 2, interleave = "block"}
+		%buf = equeue.alloc %mem, [64], f32 : !equeue.container<tensor<64xf32>, i32>
+		%v = constant 0.0 : f32
+		"equeue.write"(%v, %buf) : (f32, !equeue.container<tensor<64xf32>, i32>) -> ()
+		return
+	}
+}
@@ -0,0 +1,27 @@
+// RUN: rm -rf %t && mkdir -p %t/a %t/b
+// RUN: cp %s %t/a/layer.mlir && cp %s %t/b/layer.mlir
+// RUN: equeue-opt -batch %t/a -batch %t/b -batch-output %t/out | FileCheck %s
+// RUN: ls %t/out | FileCheck %s --check-prefix=FILES
+
+// Two inputs named layer.mlir each keep their own trace and summary.
+// CHECK: a{{/|\\}}layer.mlir layer 3
+// CHECK: b{{/|\\}}layer.mlir layer-1 3
+// CHECK: 2 inputs, 0 failed
+
+// FILES-DAG: {{^}}layer-1.json
+// FILES-DAG: {{^}}layer-1.txt
+// FILES-DAG: {{^}}layer.json
+// FILES-DAG: {{^}}layer.txt
+module {
+	func @graph() {
+		%core = equeue.create_proc ARMr5
+		%start = "equeue.control_start"():()->!equeue.signal
+		%done = equeue.launch () in (%start, %core) {
+			%c = constant 1.0 : f32
+			%x = addf %c, %c : f32
+			%y = addf %x, %c : f32
+			"equeue.return"():()->()
+		}
+		return
+	}
+}
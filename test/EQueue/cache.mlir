@@ -0,0 +1,34 @@
+// RUN: rm -rf %t.cache
+// RUN: equeue-opt %s -generate-input-file=false -stats -cache-dir %t.cache -json %t.json > %t.save
+// RUN: equeue-opt %s -generate-input-file=false -stats -cache-dir %t.cache -json %t.json > %t.load
+// RUN: FileCheck %s --check-prefix=SAVE < %t.save
+// RUN: FileCheck %s --check-prefix=LOAD < %t.load
+// RUN: grep "simulated time" %t.save > %t.save.time
+// RUN: grep "simulated time" %t.load > %t.load.time
+// RUN: diff %t.save.time %t.load.time
+
+// The second run takes the analysis, including the interpreter registers of
+// the computed trip count and of the launch arguments, from the cache file
+// and simulates the same time.
+// SAVE: analysis: {{[0-9]+\.[0-9]+}} ms, saved to the cache
+// LOAD: analysis: {{[0-9]+\.[0-9]+}} ms, loaded from the cache
+module {
+	func @graph() {
+		%core = equeue.create_proc ARMr5
+		%c0 = constant 0 : index
+		%c1 = constant 1 : index
+		%n = addi %c1, %c1 : index
+		%start = "equeue.control_start"():()->!equeue.signal
+		%done = equeue.launch (%n0 = %n : index) in (%start, %core) {
+			%z = constant 0 : index
+			%one = constant 1 : index
+			%f = constant 1.0 : f32
+			scf.for %i = %z to %n0 step %one {
+				%x = addf %f, %f : f32
+			}
+			"equeue.return"():()->()
+		}
+		"equeue.await"(%done):(!equeue.signal)->()
+		return
+	}
+}
@@ -0,0 +1,30 @@
+// RUN: equeue-opt %s -generate-input-file=false -stats -json %t.json | FileCheck %s
+
+// A direct-mapped cache of four lines of four data lines in front of a DRAM.
+// The buffer is allocated at time 1 in the address space of the DRAM.
+// - The write of line 0 misses (10 cycles from 2), fetches the line from
+//   row 0 of the DRAM (tRCD + tCAS = 10, then 4 cycles on the bus, until 26)
+//   and keeps it dirty.
+// - The read of line 0 hits, 1 cycle from 27 to 28.
+// - Line 16 maps to the same set. Its read misses (10 cycles from 29), writes
+//   the dirty victim back to the open row (tCAS = 5, until 48) and fetches
+//   the new line from the same row (until 58).
+// CHECK: simulated time: 58
+// CHECK: cache hits misses writebacks hit rate
+// CHECK-NEXT: Cache_0 1 2 1 33.3%
+// CHECK: dram hits misses conflicts refreshes hit rate bytes/cycle
+// CHECK-NEXT: DRAM_0 2 1 0 0 66.7% 1.04
+module {
+	func @graph() {
+		%dram = equeue.create_mem [1024], f32, DRAM
+		%cache = equeue.create_mem [16], f32, Cache(%dram) {assoc = 1, line_size = 4}
+		%buf = equeue.alloc %cache, [64], f32 : !equeue.container<tensor<64xf32>, i32>
+		%c0 = constant 0 : index
+		%c16 = constant 16 : index
+		%f = constant 1.0 : f32
+		"equeue.write"(%f, %buf, %c0) : (f32, !equeue.container<tensor<64xf32>, i32>, index) -> ()
+		%a = "equeue.read"(%buf, %c0) : (!equeue.container<tensor<64xf32>, i32>, index) -> f32
+		%b = "equeue.read"(%buf, %c16) : (!equeue.container<tensor<64xf32>, i32>, index) -> f32
+		return
+	}
+}
@@ -0,0 +1,57 @@
+// RUN: equeue-opt %s -generate-input-file=false -equeue-simulate -json %t.json > %t.before
+// RUN: equeue-opt %s -generate-input-file=false -canonicalize -equeue-simulate -json %t.json > %t.after
+// RUN: FileCheck %s < %t.after
+// RUN: cat %t.before %t.after | FileCheck %s --check-prefix=CYCLES
+
+// The rewrites drop operands and erase only starts, control_ands and awaits
+// that are done once they are looked at, so the simulated time is the same
+// before and after.
+// CYCLES: equeue.latency = [[#CYCLES:]] : i64
+// CYCLES: equeue.latency = [[#CYCLES]] : i64
+module {
+	// CHECK-LABEL: func @graph()
+	func @graph() {
+		%mem = equeue.create_mem [64], f32, SRAM
+		%host = equeue.create_proc ARMr5
+		%dma = "equeue.create_dma"():()->i32
+		%accel = "equeue.create_comp"(%host, %dma, %mem):(i32, i32, i32) -> i32
+
+		%start = "equeue.control_start"():()->!equeue.signal
+		%done = equeue.launch (%d, %m = %dma, %mem : i32, i32) in (%start, %host) {
+			%a = equeue.alloc %m, [4], f32 : !equeue.container<tensor<4xf32>, i32>
+			%b = equeue.alloc %m, [4], f32 : !equeue.container<tensor<4xf32>, i32>
+			// CHECK: %[[S0:.*]] = "equeue.control_start"
+			%s0 = "equeue.control_start"():()->!equeue.signal
+			// CHECK-NEXT: %[[COPIED:.*]] = "equeue.memcpy"(%[[S0]]
+			%copied = "equeue.memcpy"(%s0, %a, %b, %d): (!equeue.signal, !equeue.container<tensor<4xf32>, i32>, !equeue.container<tensor<4xf32>, i32>, i32) -> !equeue.signal
+			// the starts are done before %both is looked at and are dropped, %s1
+			// is left without uses and erased
+			// CHECK-NOT: "equeue.control_start"
+			%s1 = "equeue.control_start"():()->!equeue.signal
+			// CHECK: %[[BOTH:.*]] = "equeue.control_and"(%[[COPIED]]) :
+			%both = "equeue.control_and"(%copied, %s0, %s1, %copied):(!equeue.signal, !equeue.signal, !equeue.signal, !equeue.signal)->!equeue.signal
+			// CHECK-NEXT: %[[EITHER:.*]] = "equeue.control_or"(%[[BOTH]]) :
+			%either = "equeue.control_or"(%both, %both):(!equeue.signal, !equeue.signal)->!equeue.signal
+			// CHECK-NEXT: "equeue.await"(%[[EITHER]]) :
+			"equeue.await"(%either, %either):(!equeue.signal, !equeue.signal)->()
+			// CHECK-NEXT: "equeue.await"(%[[COPIED]]) :
+			"equeue.await"(%copied, %copied):(!equeue.signal, !equeue.signal)->()
+			// CHECK-NEXT: %[[S2:.*]] = "equeue.control_start"
+			%s2 = "equeue.control_start"():()->!equeue.signal
+			// %now pops with %s2 and folds to it
+			// CHECK-NOT: "equeue.control_and"
+			%now = "equeue.control_and"(%s2):(!equeue.signal)->!equeue.signal
+			// %either was awaited above
+			// CHECK: "equeue.await"(%[[S2]]) :
+			"equeue.await"(%now, %either):(!equeue.signal, !equeue.signal)->()
+			// both signals were awaited above, the await is erased
+			// CHECK-NOT: "equeue.await"
+			"equeue.await"(%copied, %either):(!equeue.signal, !equeue.signal)->()
+			// CHECK: equeue.dealloc
+			equeue.dealloc %a, %b : !equeue.container<tensor<4xf32>, i32>, !equeue.container<tensor<4xf32>, i32>
+			"equeue.return"():()->()
+		}
+		"equeue.await"(%done):(!equeue.signal)->()
+		return
+	}
+}
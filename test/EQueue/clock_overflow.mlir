@@ -0,0 +1,12 @@
+// RUN: not equeue-opt %s -generate-input-file=false -json %t.json 2>&1 | FileCheck %s
+
+// Two clocks of coprime frequencies near 2^32 MHz have a common multiple,
+// the length of a tick, far beyond 64 bits.
+module {
+	func @graph() {
+		%core = equeue.create_proc ARMr5 {frequency = 4294967291}
+		// CHECK: error: frequency 4294967279 MHz has no common multiple with the other clocks that fits in 64 bits
+		%mem = equeue.create_mem [64], f32, SRAM {frequency = 4294967279}
+		return
+	}
+}
@@ -0,0 +1,21 @@
+// RUN: not equeue-opt %s -generate-input-file=false -json %t.json 2>&1 | FileCheck %s
+
+// Buffers passed into a launch are only seen by the verifier as arguments
+// of its body, the simulator reports a concatenation across memories.
+module {
+	func @graph() {
+		%mem0 = equeue.create_mem [64], f32, SRAM
+		%mem1 = equeue.create_mem [64], f32, SRAM
+		%core = equeue.create_proc ARMr5
+		%a = equeue.alloc %mem0, [4], f32 : !equeue.container<tensor<4xf32>, i32>
+		%b = equeue.alloc %mem1, [4], f32 : !equeue.container<tensor<4xf32>, i32>
+		%start = "equeue.control_start"():()->!equeue.signal
+		%done = equeue.launch (%x, %y = %a, %b : !equeue.container<tensor<4xf32>, i32>, !equeue.container<tensor<4xf32>, i32>) in (%start, %core)
+		{
+			// CHECK: error: concat_container operands must live on the same memory
+			%xy = "equeue.concat_container"(%x, %y) : (!equeue.container<tensor<4xf32>, i32>, !equeue.container<tensor<4xf32>, i32>) -> !equeue.container<tensor<8xf32>, i32>
+			"equeue.return"():()->()
+		}
+		return
+	}
+}
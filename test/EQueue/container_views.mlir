@@ -0,0 +1,29 @@
+// RUN: equeue-opt %s -generate-input-file=false -equeue-simulate -json %t.json | FileCheck %s
+
+// A core writes the first line of a five-line window at time 2, 2 cycles
+// after the launch, and reads the window rotated by one line. Views take no
+// time, the read of both runs of the rotated window ends at time 6.
+
+module {
+	// CHECK-LABEL: func @graph()
+	// CHECK-SAME: equeue.latency = 6 : i64
+	func @graph() {
+		%sram = equeue.create_mem [64], f32, SRAM
+		%core = equeue.create_proc ARMr5
+		%start = "equeue.control_start"():()->!equeue.signal
+		%done = equeue.launch (%mem = %sram : i32) in (%start, %core)
+		{
+			%window = equeue.alloc %mem, [5], f32 : !equeue.container<tensor<5xf32>, i32>
+			// CHECK: "equeue.split_container"
+			// CHECK-SAME: sizes = [1, 4]
+			%views:2 = "equeue.split_container"(%window) {sizes = [1, 4]} : (!equeue.container<tensor<5xf32>, i32>) -> (!equeue.container<f32, i32>, !equeue.container<tensor<4xf32>, i32>)
+			%value = constant 1.0 : f32
+			"equeue.write"(%value, %views#0): (f32, !equeue.container<f32, i32>)->()
+			// CHECK: "equeue.concat_container"
+			%shifted = "equeue.concat_container"(%views#1, %views#0) : (!equeue.container<tensor<4xf32>, i32>, !equeue.container<f32, i32>) -> !equeue.container<tensor<5xf32>, i32>
+			%data = "equeue.read"(%shifted) : (!equeue.container<tensor<5xf32>, i32>) -> tensor<5xf32>
+			"equeue.return"():()->()
+		}
+		return
+	}
+}
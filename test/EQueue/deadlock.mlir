@@ -0,0 +1,24 @@
+// RUN: not equeue-opt %s -generate-input-file=false -json %t.json 2>&1 | FileCheck %s
+
+// A core launches onto itself and waits for the launch, which can only
+// start once the core is idle. The watchdog stops the simulation and
+// reports the cycle of the wait-for graph.
+// CHECK: error: simulation deadlocked at time {{[0-9]+}}: ARMr5_0 -> 'equeue.await' -> signal of 'equeue.launch' -> ARMr5_0
+// CHECK: note: signal of 'equeue.launch'
+module {
+	func @graph() {
+		%core = equeue.create_proc ARMr5
+		%start = "equeue.control_start"():()->!equeue.signal
+		%done = equeue.launch (%c, %s = %core, %start : i32, !equeue.signal) in (%start, %core)
+		{
+			%inner = equeue.launch () in (%s, %c)
+			{
+				"equeue.return"():()->()
+			}
+			"equeue.await"(%inner):(!equeue.signal)->()
+			"equeue.return"():()->()
+		}
+		"equeue.await"(%done):(!equeue.signal)->()
+		return
+	}
+}
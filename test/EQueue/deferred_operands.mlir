@@ -0,0 +1,32 @@
+// RUN: equeue-opt %s -generate-input-file=false -stats -json %t.json | FileCheck %s
+
+// The host issues three copies of one DRAM line at offsets 0, 2048 and 4096,
+// rows 0, 1 and 2 of bank 0. Each copy waits for the one of the previous
+// iteration, so the host is done with the loop long before the DMA starts the
+// last two. Every copy still reads the offset of the iteration that issued
+// it: the first one opens row 0 and the other two each close the open row.
+// Offsets read when the copies start would move both to row 2 and hit.
+// CHECK: dram hits misses conflicts refreshes hit rate bytes/cycle
+// CHECK-NEXT: DRAM_0 0 1 2 0 0.0%
+module {
+	func @graph() {
+		%dram = equeue.create_mem [8192], f32, DRAM
+		%sram = equeue.create_mem [64], f32, SRAM
+		%dma = "equeue.create_dma"():()->i32
+		%src = equeue.alloc %dram, [8192], f32 : !equeue.container<tensor<8192xf32>, i32>
+		%dst = equeue.alloc %sram, [1], f32 : !equeue.container<tensor<1xf32>, i32>
+		%c0 = constant 0 : index
+		%c1 = constant 1 : index
+		%c3 = constant 3 : index
+		%c2048 = constant 2048 : index
+		%start = "equeue.control_start"():()->!equeue.signal
+		%done = scf.for %i = %c0 to %c3 step %c1 iter_args(%s = %start) -> (!equeue.signal) {
+			%offset = muli %i, %c2048 : index
+			%copied = "equeue.memcpy"(%s, %src, %dst, %dma, %offset): (!equeue.signal, !equeue.container<tensor<8192xf32>, i32>, !equeue.container<tensor<1xf32>, i32>, i32, index) -> !equeue.signal
+			scf.yield %copied : !equeue.signal
+		}
+		"equeue.await"(%done):(!equeue.signal)->()
+		equeue.dealloc %src, %dst : !equeue.container<tensor<8192xf32>, i32>, !equeue.container<tensor<1xf32>, i32>
+		return
+	}
+}
@@ -0,0 +1,61 @@
+// RUN: equeue-opt %s -generate-input-file=false -equeue-simulate -json %t.json | FileCheck %s
+
+// Each transfer of 4 lines takes 3 cycles: 2 of warmup and 1 of data. The
+// four allocs end at time 5.
+module {
+	// One channel: the second transfer starts after the first one.
+	// CHECK-LABEL: func @graph()
+	// CHECK-SAME: equeue.latency = 12 : i64
+	func @graph() {
+		%m0 = equeue.create_mem [64], f32, SRAM
+		%m1 = equeue.create_mem [64], f32, SRAM
+		%m2 = equeue.create_mem [64], f32, SRAM
+		%m3 = equeue.create_mem [64], f32, SRAM
+		%dma = "equeue.create_dma"():()->i32
+		%a = equeue.alloc %m0, [4], f32 : !equeue.container<tensor<4xf32>, i32>
+		%b = equeue.alloc %m1, [4], f32 : !equeue.container<tensor<4xf32>, i32>
+		%c = equeue.alloc %m2, [4], f32 : !equeue.container<tensor<4xf32>, i32>
+		%d = equeue.alloc %m3, [4], f32 : !equeue.container<tensor<4xf32>, i32>
+		%start = "equeue.control_start"():()->!equeue.signal
+		%ab = "equeue.memcpy"(%start, %a, %b, %dma): (!equeue.signal, !equeue.container<tensor<4xf32>, i32>, !equeue.container<tensor<4xf32>, i32>, i32) -> !equeue.signal
+		%cd = "equeue.memcpy"(%start, %c, %d, %dma): (!equeue.signal, !equeue.container<tensor<4xf32>, i32>, !equeue.container<tensor<4xf32>, i32>, i32) -> !equeue.signal
+		"equeue.await"(%ab, %cd):(!equeue.signal, !equeue.signal)->()
+		return
+	}
+
+	// Two channels: both transfers run from time 5 to 8.
+	// CHECK-LABEL: func @channels()
+	// CHECK-SAME: equeue.latency = 8 : i64
+	func @channels() attributes {equeue.entry} {
+		%m0 = equeue.create_mem [64], f32, SRAM
+		%m1 = equeue.create_mem [64], f32, SRAM
+		%m2 = equeue.create_mem [64], f32, SRAM
+		%m3 = equeue.create_mem [64], f32, SRAM
+		%dma = "equeue.create_dma"() {channels = 2} : () -> i32
+		%a = equeue.alloc %m0, [4], f32 : !equeue.container<tensor<4xf32>, i32>
+		%b = equeue.alloc %m1, [4], f32 : !equeue.container<tensor<4xf32>, i32>
+		%c = equeue.alloc %m2, [4], f32 : !equeue.container<tensor<4xf32>, i32>
+		%d = equeue.alloc %m3, [4], f32 : !equeue.container<tensor<4xf32>, i32>
+		%start = "equeue.control_start"():()->!equeue.signal
+		%ab = "equeue.memcpy"(%start, %a, %b, %dma): (!equeue.signal, !equeue.container<tensor<4xf32>, i32>, !equeue.container<tensor<4xf32>, i32>, i32) -> !equeue.signal
+		%cd = "equeue.memcpy"(%start, %c, %d, %dma): (!equeue.signal, !equeue.container<tensor<4xf32>, i32>, !equeue.container<tensor<4xf32>, i32>, i32) -> !equeue.signal
+		"equeue.await"(%ab, %cd):(!equeue.signal, !equeue.signal)->()
+		return
+	}
+
+	// Cycle stealing moves one line per beat and leaves a cycle between
+	// beats for other accesses: 4 beats from time 3 end at 10 instead of 6.
+	// CHECK-LABEL: func @steal()
+	// CHECK-SAME: equeue.latency = 10 : i64
+	func @steal() attributes {equeue.entry} {
+		%m0 = equeue.create_mem [64], f32, SRAM
+		%m1 = equeue.create_mem [64], f32, SRAM
+		%dma = "equeue.create_dma"() {mode = "steal"} : () -> i32
+		%a = equeue.alloc %m0, [4], f32 : !equeue.container<tensor<4xf32>, i32>
+		%b = equeue.alloc %m1, [4], f32 : !equeue.container<tensor<4xf32>, i32>
+		%start = "equeue.control_start"():()->!equeue.signal
+		%ab = "equeue.memcpy"(%start, %a, %b, %dma): (!equeue.signal, !equeue.container<tensor<4xf32>, i32>, !equeue.container<tensor<4xf32>, i32>, i32) -> !equeue.signal
+		"equeue.await"(%ab):(!equeue.signal)->()
+		return
+	}
+}
@@ -0,0 +1,65 @@
+// RUN: equeue-opt %s -generate-input-file=false -equeue-double-buffer -json %t.json | FileCheck %s
+
+// The fill of the next buffer and the drain of the previous one run on their
+// own DMAs, so the ping-pong loop overlaps the copies of one buffer set with
+// the compute on the other and the rewrite is kept. Each half of the body
+// fills, computes on and drains its own buffers, and waits only for the
+// previous use of them.
+module {
+	// CHECK-LABEL: func @graph()
+	// CHECK: %[[IN:[^ ]+]] = "equeue.alloc"(%[[LOCAL:[^)]+]])
+	// CHECK-NEXT: %[[IN2:[^ ]+]] = "equeue.alloc"(%[[LOCAL]])
+	// CHECK-NEXT: %[[OUT:[^ ]+]] = "equeue.alloc"(%[[LOCAL]])
+	// CHECK-NEXT: %[[OUT2:[^ ]+]] = "equeue.alloc"(%[[LOCAL]])
+	// CHECK-NEXT: %[[SRC:[^ ]+]] = "equeue.alloc"
+	// CHECK-NEXT: %[[DST:[^ ]+]] = "equeue.alloc"
+	// CHECK: %[[START:[^ ]+]] = "equeue.control_start"
+	// CHECK: %[[LOOP:[^:]+]]:2 = scf.for %[[IV:[^ ]+]] = %{{[^ ]+}} to %{{[^ ]+}} step %{{[^ ]+}} iter_args(%[[PING:[^ ]+]] = %[[START]], %[[PONG:[^ ]+]] = %[[START]]) -> (!equeue.signal, !equeue.signal)
+	// CHECK-NEXT: %[[FILL0:[^ ]+]] = "equeue.memcpy"(%[[PING]], %[[SRC]], %[[IN]], %[[DMA_IN:[^)]+]])
+	// CHECK-NEXT: %[[RUN0:[^ ]+]] = "equeue.launch"(%[[FILL0]], %[[CORE:[^,]+]], %[[IN]], %[[OUT]])
+	// CHECK: %[[DRAIN0:[^ ]+]] = "equeue.memcpy"(%[[RUN0]], %[[OUT]], %[[DST]], %[[DMA_OUT:[^)]+]])
+	// CHECK-NEXT: %[[STEP:[^ ]+]] = constant 1 : index
+	// CHECK-NEXT: %[[NEXT:[^ ]+]] = addi %[[IV]], %[[STEP]] : index
+	// CHECK-NEXT: %[[FILL1:[^ ]+]] = "equeue.memcpy"(%[[PONG]], %[[SRC]], %[[IN2]], %[[DMA_IN]])
+	// CHECK-NEXT: %[[RUN1:[^ ]+]] = "equeue.launch"(%[[FILL1]], %[[CORE]], %[[IN2]], %[[OUT2]])
+	// CHECK: %[[DRAIN1:[^ ]+]] = "equeue.memcpy"(%[[RUN1]], %[[OUT2]], %[[DST]], %[[DMA_OUT]])
+	// CHECK-NEXT: scf.yield %[[DRAIN0]], %[[DRAIN1]] : !equeue.signal, !equeue.signal
+	// CHECK: %[[DONE:[^ ]+]] = "equeue.control_and"(%[[LOOP]]#0, %[[LOOP]]#1)
+	// CHECK-NEXT: "equeue.await"(%[[DONE]])
+	// CHECK-NEXT: "equeue.dealloc"(%[[IN]], %[[OUT]], %[[SRC]], %[[DST]])
+	// CHECK-DAG: "equeue.dealloc"(%[[IN2]])
+	// CHECK-DAG: "equeue.dealloc"(%[[OUT2]])
+	func @graph() {
+		%local = equeue.create_mem [64], f32, SRAM
+		%main = equeue.create_mem [256], f32, SRAM
+		%core = equeue.create_proc ARMr5
+		%dma_in = "equeue.create_dma"():()->i32
+		%dma_out = "equeue.create_dma"():()->i32
+		%in = equeue.alloc %local, [4], f32 : !equeue.container<tensor<4xf32>, i32>
+		%out = equeue.alloc %local, [4], f32 : !equeue.container<tensor<4xf32>, i32>
+		%src = equeue.alloc %main, [4], f32 : !equeue.container<tensor<4xf32>, i32>
+		%dst = equeue.alloc %main, [4], f32 : !equeue.container<tensor<4xf32>, i32>
+		%c0 = constant 0 : index
+		%c1 = constant 1 : index
+		%c4 = constant 4 : index
+		%start = "equeue.control_start"():()->!equeue.signal
+		%done = scf.for %i = %c0 to %c4 step %c1 iter_args(%s = %start) -> (!equeue.signal) {
+			%filled = "equeue.memcpy"(%s, %src, %in, %dma_in): (!equeue.signal, !equeue.container<tensor<4xf32>, i32>, !equeue.container<tensor<4xf32>, i32>, i32) -> !equeue.signal
+			%ran = equeue.launch (%a, %b = %in, %out : !equeue.container<tensor<4xf32>, i32>, !equeue.container<tensor<4xf32>, i32>) in (%filled, %core) {
+				%v = "equeue.read"(%a) : (!equeue.container<tensor<4xf32>, i32>) -> tensor<4xf32>
+				%f = constant 1.0 : f32
+				%x = addf %f, %f : f32
+				%y = addf %x, %f : f32
+				%z = addf %y, %f : f32
+				%u = addf %z, %f : f32
+				"equeue.write"(%v, %b) : (tensor<4xf32>, !equeue.container<tensor<4xf32>, i32>) -> ()
+				"equeue.return"():()->()
+			}
+			%drained = "equeue.memcpy"(%ran, %out, %dst, %dma_out): (!equeue.signal, !equeue.container<tensor<4xf32>, i32>, !equeue.container<tensor<4xf32>, i32>, i32) -> !equeue.signal
+			scf.yield %drained : !equeue.signal
+		}
+		"equeue.await"(%done):(!equeue.signal)->()
+		equeue.dealloc %in, %out, %src, %dst : !equeue.container<tensor<4xf32>, i32>, !equeue.container<tensor<4xf32>, i32>, !equeue.container<tensor<4xf32>, i32>, !equeue.container<tensor<4xf32>, i32>
+		return
+	}
+}
@@ -0,0 +1,52 @@
+// RUN: equeue-opt %s -generate-input-file=false -equeue-double-buffer -json %t.json | FileCheck %s
+
+// One DMA fills and drains the buffers. Its event queue runs in order, so
+// the fill of the pong buffer waits behind the drain of the ping buffer and
+// the ping-pong loop overlaps nothing. The second buffers only add allocs,
+// the simulated latency gets worse and the pass leaves the loop alone.
+module {
+	// CHECK-LABEL: func @graph()
+	// CHECK-COUNT-4: "equeue.alloc"
+	// CHECK-NOT: "equeue.alloc"
+	// CHECK: scf.for %{{[^ ]+}} = %{{[^ ]+}} to %{{[^ ]+}} step %{{[^ ]+}} iter_args(%{{[^ ]+}} = %{{[^ ]+}}) -> (!equeue.signal)
+	// CHECK: "equeue.memcpy"
+	// CHECK: "equeue.launch"
+	// CHECK: "equeue.memcpy"
+	// CHECK-NOT: "equeue.memcpy"
+	// CHECK: scf.yield %{{[^ ]+}} : !equeue.signal
+	// CHECK-NOT: scf.for
+	// CHECK-NOT: equeue.control_and
+	// CHECK: return
+	func @graph() {
+		%local = equeue.create_mem [64], f32, SRAM
+		%main = equeue.create_mem [256], f32, SRAM
+		%core = equeue.create_proc ARMr5
+		%dma = "equeue.create_dma"():()->i32
+		%in = equeue.alloc %local, [4], f32 : !equeue.container<tensor<4xf32>, i32>
+		%out = equeue.alloc %local, [4], f32 : !equeue.container<tensor<4xf32>, i32>
+		%src = equeue.alloc %main, [4], f32 : !equeue.container<tensor<4xf32>, i32>
+		%dst = equeue.alloc %main, [4], f32 : !equeue.container<tensor<4xf32>, i32>
+		%c0 = constant 0 : index
+		%c1 = constant 1 : index
+		%c4 = constant 4 : index
+		%start = "equeue.control_start"():()->!equeue.signal
+		%done = scf.for %i = %c0 to %c4 step %c1 iter_args(%s = %start) -> (!equeue.signal) {
+			%filled = "equeue.memcpy"(%s, %src, %in, %dma): (!equeue.signal, !equeue.container<tensor<4xf32>, i32>, !equeue.container<tensor<4xf32>, i32>, i32) -> !equeue.signal
+			%ran = equeue.launch (%a, %b = %in, %out : !equeue.container<tensor<4xf32>, i32>, !equeue.container<tensor<4xf32>, i32>) in (%filled, %core) {
+				%v = "equeue.read"(%a) : (!equeue.container<tensor<4xf32>, i32>) -> tensor<4xf32>
+				%f = constant 1.0 : f32
+				%x = addf %f, %f : f32
+				%y = addf %x, %f : f32
+				%z = addf %y, %f : f32
+				%u = addf %z, %f : f32
+				"equeue.write"(%v, %b) : (tensor<4xf32>, !equeue.container<tensor<4xf32>, i32>) -> ()
+				"equeue.return"():()->()
+			}
+			%drained = "equeue.memcpy"(%ran, %out, %dst, %dma): (!equeue.signal, !equeue.container<tensor<4xf32>, i32>, !equeue.container<tensor<4xf32>, i32>, i32) -> !equeue.signal
+			scf.yield %drained : !equeue.signal
+		}
+		"equeue.await"(%done):(!equeue.signal)->()
+		equeue.dealloc %in, %out, %src, %dst : !equeue.container<tensor<4xf32>, i32>, !equeue.container<tensor<4xf32>, i32>, !equeue.container<tensor<4xf32>, i32>, !equeue.container<tensor<4xf32>, i32>
+		return
+	}
+}
@@ -0,0 +1,23 @@
+// RUN: equeue-opt %s -generate-input-file=false -stats -json %t.json | FileCheck %s
+
+// The host reads three lines of a DRAM after allocating it at time 1. The
+// first read opens row 0 of bank 0 (tRCD + tCAS = 10, then a cycle on the
+// bus), the second one hits that row (tCAS = 5), the third one is in row 1
+// of the same bank and has to precharge first (tRP + tRCD + tCAS = 15).
+// Each access waits for the port of the bank to be free.
+// CHECK: simulated time: 37
+// CHECK: dram hits misses conflicts refreshes hit rate bytes/cycle
+// CHECK-NEXT: DRAM_0 1 1 1 0 33.3% 0.34
+module {
+	func @graph() {
+		%mem = equeue.create_mem [4096], f32, DRAM
+		%buf = equeue.alloc %mem, [4096], f32 : !equeue.container<tensor<4096xf32>, i32>
+		%c0 = constant 0 : index
+		%c1 = constant 1 : index
+		%c2048 = constant 2048 : index
+		%a = "equeue.read"(%buf, %c0) : (!equeue.container<tensor<4096xf32>, i32>, index) -> f32
+		%b = "equeue.read"(%buf, %c1) : (!equeue.container<tensor<4096xf32>, i32>, index) -> f32
+		%c = "equeue.read"(%buf, %c2048) : (!equeue.container<tensor<4096xf32>, i32>, index) -> f32
+		return
+	}
+}
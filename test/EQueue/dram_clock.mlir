@@ -0,0 +1,21 @@
+// RUN: equeue-opt %s -generate-input-file=false -stats -json %t.json | FileCheck %s
+
+// The reads of dram.mlir on a DRAM clocked at half the frequency of the host.
+// A DRAM cycle is two ticks, so the row timings and the bus take twice as
+// many ticks: the reads move 12 bytes from tick 2 to tick 70, 34 cycles of
+// the DRAM.
+// CHECK: dram hits misses conflicts refreshes hit rate bytes/cycle
+// CHECK-NEXT: DRAM_0 1 1 1 0 33.3% 0.35
+module {
+	func @graph() {
+		%mem = equeue.create_mem [4096], f32, DRAM {frequency = 500}
+		%buf = equeue.alloc %mem, [4096], f32 : !equeue.container<tensor<4096xf32>, i32>
+		%c0 = constant 0 : index
+		%c1 = constant 1 : index
+		%c2048 = constant 2048 : index
+		%a = "equeue.read"(%buf, %c0) : (!equeue.container<tensor<4096xf32>, i32>, index) -> f32
+		%b = "equeue.read"(%buf, %c1) : (!equeue.container<tensor<4096xf32>, i32>, index) -> f32
+		%c = "equeue.read"(%buf, %c2048) : (!equeue.container<tensor<4096xf32>, i32>, index) -> f32
+		return
+	}
+}
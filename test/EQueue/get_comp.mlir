@@ -0,0 +1,40 @@
+// RUN: equeue-opt %s -generate-input-file=false -json %t.json | FileCheck %s
+
+module {
+	// CHECK-LABEL: func @graph()
+	func @graph() {
+		%aie_mem = equeue.create_mem [16], f32, SRAM
+		%aie_core = equeue.create_proc AIEngine
+		// CHECK: names = ["mem", "core"]
+		%aie = "equeue.create_comp"(%aie_mem, %aie_core) {names = ["mem", "core"]} : (i32, i32) -> i32
+
+		%sram = equeue.create_mem [64], f32, SRAM
+		%accel_core = equeue.create_proc ARMr5
+		%accel_dma = "equeue.create_dma"():()->i32
+		%accel = "equeue.create_comp"(%accel_core, %aie, %accel_dma, %sram) {names = ["core", "aie", "dma", "sram"]} : (i32, i32, i32, i32) -> i32
+
+		%start = "equeue.control_start"():()->!equeue.signal
+		// only the component is passed into the launch
+		%done = equeue.launch (%acc = %accel : i32) in (%start, %accel_core) {
+			// CHECK: equeue.get_comp %{{.*}}, "aie"
+			%pe = equeue.get_comp %acc, "aie"
+			%dma = equeue.get_comp %acc, "dma"
+			%m0 = equeue.get_comp %acc, "sram"
+			%m1 = equeue.get_comp %pe, "mem"
+			%core = equeue.get_comp %pe, "core"
+			%a = equeue.alloc %m0, [4], f32 : !equeue.container<tensor<4xf32>, i32>
+			%b = equeue.alloc %m1, [4], f32 : !equeue.container<tensor<4xf32>, i32>
+			%s0 = "equeue.control_start"():()->!equeue.signal
+			%copied = "equeue.memcpy"(%s0, %a, %b, %dma): (!equeue.signal, !equeue.container<tensor<4xf32>, i32>, !equeue.container<tensor<4xf32>, i32>, i32) -> !equeue.signal
+			%computed = equeue.launch (%buf = %b : !equeue.container<tensor<4xf32>, i32>) in (%copied, %core) {
+				%v = "equeue.read"(%buf) : (!equeue.container<tensor<4xf32>, i32>) -> tensor<4xf32>
+				"equeue.return"():()->()
+			}
+			"equeue.await"(%computed):(!equeue.signal)->()
+			equeue.dealloc %a, %b : !equeue.container<tensor<4xf32>, i32>, !equeue.container<tensor<4xf32>, i32>
+			"equeue.return"():()->()
+		}
+		"equeue.await"(%done):(!equeue.signal)->()
+		return
+	}
+}
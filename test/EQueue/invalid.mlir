@@ -0,0 +1,102 @@
+// RUN: equeue-opt %s -generate-input-file=false -split-input-file -verify-diagnostics
+
+func @graph() {
+	%dram = equeue.create_mem [4096], f32, DRAM
+	// expected-error@+1 {{only a Cache has a parent memory, not SRAM}}
+	%sram = equeue.create_mem [64], f32, SRAM(%dram)
+	return
+}
+
+// -----
+
+func @graph() {
+	%core = equeue.create_proc ARMr5
+	// expected-error@+1 {{parent must be a memory}}
+	%cache = equeue.create_mem [64], f32, Cache(%core)
+	return
+}
+
+// -----
+
+func @graph() {
+	%mem = equeue.create_mem [64], f32, SRAM
+	%buf = equeue.alloc %mem, [16], f32 : !equeue.container<tensor<16xf32>, i32>
+	%c0 = constant 0 : index
+	// expected-error@+1 {{size must be positive, not 0}}
+	%v = "equeue.read"(%buf, %c0) {size = 0} : (!equeue.container<tensor<16xf32>, i32>, index) -> tensor<4xf32>
+	return
+}
+
+// -----
+
+func @graph() {
+	%mem = equeue.create_mem [64], f32, SRAM
+	%buf = equeue.alloc %mem, [16], f32 : !equeue.container<tensor<16xf32>, i32>
+	%v = constant 0.0 : f32
+	%c0 = constant 0 : index
+	// expected-error@+1 {{stride must be positive, not -1}}
+	"equeue.write"(%v, %buf, %c0) {size = 4, stride = -1} : (f32, !equeue.container<tensor<16xf32>, i32>, index) -> ()
+	return
+}
+
+// -----
+
+func @graph() {
+	%mem = equeue.create_mem [64], f32, SRAM
+	%buf = equeue.alloc %mem, [4, 4], f32 : !equeue.container<tensor<4x4xf32>, i32>
+	%c0 = constant 0 : index
+	%c2 = constant 2 : index
+	// expected-error@+1 {{accesses lines 2 to 14 of a buffer of 16 lines}}
+	%v = "equeue.read"(%buf, %c0, %c2) {size = 4, stride = 4} : (!equeue.container<tensor<4x4xf32>, i32>, index, index) -> tensor<4xf32>
+	%c3 = constant 3 : index
+	// expected-error@+1 {{accesses lines 14 to 17 of a buffer of 16 lines}}
+	%w = "equeue.read"(%buf, %c3, %c2) {size = 4} : (!equeue.container<tensor<4x4xf32>, i32>, index, index) -> tensor<4xf32>
+	return
+}
+
+// -----
+
+func @graph() {
+	%sram = equeue.create_mem [64], f32, SRAM
+	%dma = "equeue.create_dma"():()->i32
+	%start = "equeue.control_start"():()->!equeue.signal
+	%big = equeue.alloc %sram, [16], f32 : !equeue.container<tensor<16xf32>, i32>
+	%small = equeue.alloc %sram, [4], f32 : !equeue.container<tensor<4xf32>, i32>
+	%c1 = constant 1 : index
+	// expected-error@+1 {{accesses lines 1 to 19 of a buffer of 16 lines}}
+	%done = "equeue.memcpy"(%start, %big, %small, %dma, %c1) {stride = 6} : (!equeue.signal, !equeue.container<tensor<16xf32>, i32>, !equeue.container<tensor<4xf32>, i32>, i32, index) -> !equeue.signal
+	return
+}
+
+// -----
+
+func @graph() {
+	%mem = equeue.create_mem [64], f32, SRAM
+	%buf = equeue.alloc %mem, [5], f32 : !equeue.container<tensor<5xf32>, i32>
+	// expected-error@+1 {{sizes add up to 4 lines, the buffer has 5}}
+	%views:2 = "equeue.split_container"(%buf) {sizes = [1, 3]} : (!equeue.container<tensor<5xf32>, i32>) -> (!equeue.container<f32, i32>, !equeue.container<tensor<3xf32>, i32>)
+	return
+}
+
+// -----
+
+func @graph() {
+	%mem = equeue.create_mem [64], f32, SRAM
+	%buf = equeue.alloc %mem, [5], f32 : !equeue.container<tensor<5xf32>, i32>
+	// expected-error@+1 {{has 2 views but 3 sizes}}
+	%views:2 = "equeue.split_container"(%buf) {sizes = [1, 2, 2]} : (!equeue.container<tensor<5xf32>, i32>) -> (!equeue.container<f32, i32>, !equeue.container<tensor<4xf32>, i32>)
+	return
+}
+
+// -----
+
+func @graph() {
+	%mem0 = equeue.create_mem [64], f32, SRAM
+	%mem1 = equeue.create_mem [64], f32, SRAM
+	%a = equeue.alloc %mem0, [4], f32 : !equeue.container<tensor<4xf32>, i32>
+	%b = equeue.alloc %mem1, [4], f32 : !equeue.container<tensor<4xf32>, i32>
+	%views:2 = "equeue.split_container"(%b) {sizes = [2, 2]} : (!equeue.container<tensor<4xf32>, i32>) -> (!equeue.container<tensor<2xf32>, i32>, !equeue.container<tensor<2xf32>, i32>)
+	// expected-error@+1 {{buffers must live on the same memory}}
+	%ab = "equeue.concat_container"(%a, %views#1) : (!equeue.container<tensor<4xf32>, i32>, !equeue.container<tensor<2xf32>, i32>) -> !equeue.container<tensor<6xf32>, i32>
+	return
+}
@@ -0,0 +1,22 @@
+// RUN: equeue-opt %s -generate-input-file=false -monte-carlo=16 -seed=1 -threads=2 -json %t.json | FileCheck %s
+
+// The host writes one line of an SRAM after allocating it at time 1. The
+// write costs 2 cycles scaled by a factor drawn from [0.5, 1.5], rounded to
+// 1 to 3 cycles, so every run ends at time 3 to 5.
+// CHECK: monte carlo: 16 runs, seeds 1 to 16
+// CHECK-NEXT: time real time seed
+// CHECK-NEXT: min {{[3-5]}} {{[3-5]}} {{[0-9]+}}
+// CHECK-NEXT: p50 {{[3-5]}} {{[3-5]}} {{[0-9]+}}
+// CHECK-NEXT: p95 {{[3-5]}} {{[3-5]}} {{[0-9]+}}
+// CHECK-NEXT: p99 {{[3-5]}} {{[3-5]}} {{[0-9]+}}
+// CHECK-NEXT: max {{[3-5]}} {{[3-5]}} {{[0-9]+}}
+// CHECK-NEXT: mean {{[3-5]\.[0-9]}}
+module {
+	func @graph() {
+		%mem = equeue.create_mem [64], f32, SRAM {latency = "uniform", jitter = 0.5}
+		%buf = equeue.alloc %mem, [1], f32 : !equeue.container<f32, i32>
+		%v = constant 0.0 : f32
+		"equeue.write"(%v, %buf) : (f32, !equeue.container<f32, i32>) -> ()
+		return
+	}
+}
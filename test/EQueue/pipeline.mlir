@@ -0,0 +1,41 @@
+// RUN: equeue-opt %s -generate-input-file=false -equeue-simulate -json %t.json | FileCheck %s
+
+// Two allocs and two reads of an SRAM on an in-order core take 1 + 1 + 2 + 2
+// cycles after the launch at time 1. A core issuing two ops per cycle with
+// two in flight overlaps the allocs and then the reads, and drains the
+// pipeline before the launch returns.
+module {
+	// CHECK-LABEL: func @graph()
+	// CHECK-SAME: equeue.latency = 7 : i64
+	func @graph() {
+		%mem = equeue.create_mem [64], f32, SRAM
+		%core = equeue.create_proc ARMr5
+		%start = "equeue.control_start"():()->!equeue.signal
+		%done = equeue.launch (%m = %mem : i32) in (%start, %core) {
+			%a = equeue.alloc %m, [4], f32 : !equeue.container<tensor<4xf32>, i32>
+			%b = equeue.alloc %m, [4], f32 : !equeue.container<tensor<4xf32>, i32>
+			%va = "equeue.read"(%a) : (!equeue.container<tensor<4xf32>, i32>) -> tensor<4xf32>
+			%vb = "equeue.read"(%b) : (!equeue.container<tensor<4xf32>, i32>) -> tensor<4xf32>
+			"equeue.return"():()->()
+		}
+		"equeue.await"(%done):(!equeue.signal)->()
+		return
+	}
+
+	// CHECK-LABEL: func @pipelined()
+	// CHECK-SAME: equeue.latency = 4 : i64
+	func @pipelined() attributes {equeue.entry} {
+		%mem = equeue.create_mem [64], f32, SRAM
+		%core = equeue.create_proc ARMr5 {issue_width = 2, pipeline_depth = 2}
+		%start = "equeue.control_start"():()->!equeue.signal
+		%done = equeue.launch (%m = %mem : i32) in (%start, %core) {
+			%a = equeue.alloc %m, [4], f32 : !equeue.container<tensor<4xf32>, i32>
+			%b = equeue.alloc %m, [4], f32 : !equeue.container<tensor<4xf32>, i32>
+			%va = "equeue.read"(%a) : (!equeue.container<tensor<4xf32>, i32>) -> tensor<4xf32>
+			%vb = "equeue.read"(%b) : (!equeue.container<tensor<4xf32>, i32>) -> tensor<4xf32>
+			"equeue.return"():()->()
+		}
+		"equeue.await"(%done):(!equeue.signal)->()
+		return
+	}
+}
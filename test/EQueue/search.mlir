@@ -0,0 +1,32 @@
+// RUN: equeue-opt -search-conv=1,2,2,2,2,2 -search-cores 2 -search-local-mem 9 -search-keep 2 -o %t.mlir -json %t.json | FileCheck %s
+// RUN: FileCheck %s --check-prefix=PROGRAM < %t.mlir
+// RUN: equeue-opt %t.mlir -generate-input-file=false -json %t.sim.json
+
+// A 1x1 output of 2 channels. Only 1x1x1 tiles fit 9 lines of local memory:
+// 4 input lines, 4 weight lines and 1 output line. With the channel loop
+// outermost each core computes one tile. The two such orders generate the
+// same program and tie, so the first one in enumeration order wins.
+// CHECK: mapping estimate latency
+// CHECK-NEXT: tiles 1x1x1 order khw on 2 cores {{[0-9]+}} [[#LATENCY:]]
+// CHECK-NEXT: tiles 1x1x1 order kwh on 2 cores {{[0-9]+}} [[#LATENCY]]
+// CHECK-NEXT: 6 candidates, best tiles 1x1x1 order khw on 2 cores
+
+// The program of the best mapping: the weight tile is copied in the channel
+// loop, split over the cores, and the input tile in the innermost loop.
+// PROGRAM-LABEL: func @graph()
+// PROGRAM-COUNT-2: "equeue.create_proc"() {type = "AIEngine"}
+// PROGRAM: scf.for %{{[^ ]+}} = %c0{{[_0-9]*}} to %c2{{[_0-9]*}} step %c2{{[_0-9]*}} iter_args
+// PROGRAM-NEXT: affine.apply
+// PROGRAM-NEXT: "equeue.memcpy"
+// PROGRAM-NEXT: %c0
+// PROGRAM-NEXT: %c1
+// PROGRAM-NEXT: %c1
+// PROGRAM-NEXT: scf.for
+// PROGRAM-NEXT: %c0
+// PROGRAM-NEXT: %c1
+// PROGRAM-NEXT: %c1
+// PROGRAM-NEXT: scf.for
+// PROGRAM-NEXT: affine.apply
+// PROGRAM-NEXT: "equeue.memcpy"
+// PROGRAM-NEXT: "equeue.launch"
+// PROGRAM: scf.for %{{[^ ]+}} = %c1{{[_0-9]*}} to %c2{{[_0-9]*}} step %c2{{[_0-9]*}} iter_args
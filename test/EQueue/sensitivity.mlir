@@ -0,0 +1,26 @@
+// RUN: equeue-opt %s -generate-input-file=false -sensitivity -threads=2 -json %t.json | FileCheck %s
+// RUN: equeue-opt %s -generate-input-file=false -sensitivity -sensitivity-delta=0.5 -threads=2 -json %t.json | FileCheck %s --check-prefix=HALF
+
+// An SRAM access costs its 2 minimum cycles and the DMA warms up for 2
+// cycles; both round back to 2 when scaled by 10%, so they do not move and
+// are listed apart instead of showing an elasticity of 0. Scaled by 50%
+// they become 1 and 3 cycles.
+// CHECK: sensitivity: +-10%, baseline time {{[0-9]+}}
+// CHECK: insensitive at this delta: SRAM_0.cycles_per_data SRAM_1.cycles_per_data DMA_{{[0-9]+}}.warmup_cycles
+// HALF: sensitivity: +-50%, baseline time {{[0-9]+}}
+// HALF-DAG: SRAM_0.cycles_per_data {{[0-9]+}} {{[0-9]+}} {{-?[0-9]+\.[0-9]+}}
+// HALF-DAG: DMA_{{[0-9]+}}.warmup_cycles {{[0-9]+}} {{[0-9]+}} {{-?[0-9]+\.[0-9]+}}
+// HALF-NOT: insensitive at this delta
+module {
+	func @graph() {
+		%m0 = equeue.create_mem [64], f32, SRAM
+		%m1 = equeue.create_mem [64], f32, SRAM
+		%dma = "equeue.create_dma"():()->i32
+		%a = equeue.alloc %m0, [4], f32 : !equeue.container<tensor<4xf32>, i32>
+		%b = equeue.alloc %m1, [4], f32 : !equeue.container<tensor<4xf32>, i32>
+		%start = "equeue.control_start"():()->!equeue.signal
+		%ab = "equeue.memcpy"(%start, %a, %b, %dma): (!equeue.signal, !equeue.container<tensor<4xf32>, i32>, !equeue.container<tensor<4xf32>, i32>, i32) -> !equeue.signal
+		"equeue.await"(%ab):(!equeue.signal)->()
+		return
+	}
+}
@@ -0,0 +1,30 @@
+// RUN: equeue-opt %s -generate-input-file=false -equeue-simulate -json %t.json | FileCheck %s
+
+// The launch at time 1 runs two addf on the core, which is busy for 2 of
+// the 3 cycles; the host only issues zero-latency ops. Functions that are
+// not entries get no attributes.
+module {
+	// CHECK-LABEL: func @graph()
+	// CHECK-SAME: equeue.latency = 3 : i64
+	// CHECK-SAME: equeue.utilization = {ARMr5_0 = 0.666{{[0-9]*}} : f64, host = 0.000000e+00 : f64}
+	func @graph() {
+		%core = equeue.create_proc ARMr5
+		%start = "equeue.control_start"():()->!equeue.signal
+		%done = equeue.launch () in (%start, %core) {
+			%c = constant 1.0 : f32
+			%x = addf %c, %c : f32
+			%y = addf %x, %c : f32
+			"equeue.return"():()->()
+		}
+		return
+	}
+
+	// CHECK-LABEL: func @helper()
+	// CHECK-NOT: equeue.latency
+	// CHECK-NOT: equeue.utilization
+	// CHECK: return
+	func @helper() {
+		%core = equeue.create_proc ARMr5
+		return
+	}
+}
@@ -0,0 +1,42 @@
+// RUN: equeue-opt %s -generate-input-file=false -stats -json %t.json | FileCheck %s
+
+// The host pushes two launches into the single-entry queue of ARMr5_1 and
+// blocks on the second one for a moment. ARMr5_0 asks ARMr5_1 for a third
+// launch in the same cycle as the host; fifo arbitration grants the host
+// first, so ARMr5_0 waits one cycle for room in the queue.
+// CHECK: simulated time: 4
+// CHECK-NEXT: launcher queue full stalls stall cycles
+// CHECK-NEXT: host 2 1 0
+// CHECK-NEXT: ARMr5_0 2 1 1
+// CHECK-NEXT: ARMr5_1 1 0 0
+// CHECK-NEXT: arbiter requester policy grants avg wait max wait
+// CHECK-NEXT: ARMr5_1 host fifo 2 0.0 0
+// CHECK-NEXT: ARMr5_1 ARMr5_0 fifo 1 1.0 1
+module {
+	func @graph() {
+		%a = equeue.create_proc ARMr5
+		%b = equeue.create_proc ARMr5 {queue_depth = 1}
+		%start = "equeue.control_start"():()->!equeue.signal
+		%da = equeue.launch (%bb, %s = %b, %start : i32, !equeue.signal) in (%start, %a) {
+			%x = equeue.launch () in (%s, %bb) {
+				%c = constant 1.0 : f32
+				%y = addf %c, %c : f32
+				"equeue.return"():()->()
+			}
+			"equeue.await"(%x):(!equeue.signal)->()
+			"equeue.return"():()->()
+		}
+		%dh1 = equeue.launch () in (%start, %b) {
+			%c = constant 1.0 : f32
+			%y = addf %c, %c : f32
+			"equeue.return"():()->()
+		}
+		%dh2 = equeue.launch () in (%start, %b) {
+			%c = constant 1.0 : f32
+			%y = addf %c, %c : f32
+			"equeue.return"():()->()
+		}
+		"equeue.await"(%da, %dh1, %dh2):(!equeue.signal, !equeue.signal, !equeue.signal)->()
+		return
+	}
+}
@@ -0,0 +1,28 @@
+// RUN: equeue-opt %s -generate-input-file=false -equeue-simulate -json %t.json | FileCheck %s
+
+// The host reads four lines of a 4x4 buffer on an SRAM with four cyclic
+// banks after allocating it at time 1. A row maps to all four banks, which
+// serve it in parallel. A column, stride 4, maps to a single bank, which
+// serves its lines one after the other, 2 cycles each.
+module {
+	// CHECK-LABEL: func @graph()
+	// CHECK-SAME: equeue.latency = 3 : i64
+	func @graph() {
+		%mem = equeue.create_mem [16], f32, SRAM {banks = 4}
+		%buf = equeue.alloc %mem, [4, 4], f32 : !equeue.container<tensor<4x4xf32>, i32>
+		%c1 = constant 1 : index
+		%row = "equeue.read"(%buf, %c1) {size = 4} : (!equeue.container<tensor<4x4xf32>, i32>, index) -> tensor<4xf32>
+		return
+	}
+
+	// CHECK-LABEL: func @column()
+	// CHECK-SAME: equeue.latency = 13 : i64
+	func @column() attributes {equeue.entry} {
+		%mem = equeue.create_mem [16], f32, SRAM {banks = 4}
+		%buf = equeue.alloc %mem, [4, 4], f32 : !equeue.container<tensor<4x4xf32>, i32>
+		%c0 = constant 0 : index
+		%c1 = constant 1 : index
+		%col = "equeue.read"(%buf, %c0, %c1) {size = 4, stride = 4} : (!equeue.container<tensor<4x4xf32>, i32>, index, index) -> tensor<4xf32>
+		return
+	}
+}
@@ -0,0 +1,20 @@
+// RUN: not equeue-opt %s -generate-input-file=false -json %t.json 2>&1 | FileCheck %s
+
+// A trip count loaded from memory depends on data the simulator does not
+// keep, the loop is reported instead of running zero times.
+// CHECK: error: operand #1 is not known to the simulator
+// CHECK: note: the simulator cannot compute this value
+module {
+	func @graph() {
+		%mem = equeue.create_mem [64], i32, SRAM
+		%n = equeue.alloc %mem, [1], i32 : !equeue.container<i32, i32>
+		%c0 = constant 0 : index
+		%c1 = constant 1 : index
+		%l = "equeue.read"(%n) : (!equeue.container<i32, i32>) -> i32
+		%ub = index_cast %l : i32 to index
+		scf.for %i = %c0 to %ub step %c1 {
+			%v = "equeue.read"(%n) : (!equeue.container<i32, i32>) -> i32
+		}
+		return
+	}
+}
@@ -0,0 +1,17 @@
+// RUN: not equeue-opt %s -generate-input-file=false -json %t.json 2>&1 | FileCheck %s
+
+// An index loaded from memory depends on data the simulator does not keep,
+// the access it addresses is reported instead of hitting line 0.
+module {
+	func @graph() {
+		%mem = equeue.create_mem [64], i32, SRAM
+		%idx = equeue.alloc %mem, [4], i32 : !equeue.container<tensor<4xi32>, i32>
+		%buf = equeue.alloc %mem, [16], i32 : !equeue.container<tensor<16xi32>, i32>
+		%c0 = constant 0 : index
+		%l = "equeue.read"(%idx, %c0) : (!equeue.container<tensor<4xi32>, i32>, index) -> i32
+		%i = index_cast %l : i32 to index
+		// CHECK: error: index 0 is not known to the simulator
+		%v = "equeue.read"(%buf, %i) : (!equeue.container<tensor<16xi32>, i32>, index) -> i32
+		return
+	}
+}
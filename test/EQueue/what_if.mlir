@@ -0,0 +1,31 @@
+// RUN: equeue-opt %s -generate-input-file=false -what-if=DMA_0.warmup_cycles=2 -verify-incremental -json %t.json | FileCheck %s
+// RUN: not equeue-opt %s -generate-input-file=false -what-if=loop.upper_bound=2 -json %t.json 2>&1 | FileCheck %s --check-prefix=LOOP
+
+// The host computes for a while before its only transfer, so the run with
+// twice the DMA warmup resumes from a checkpoint just before the DMA is
+// used, and matches the full rerun 2 cycles later.
+// CHECK: baseline time [[#BASE:]]
+// CHECK-NEXT: what-if time [[#BASE+2]], resumed at step {{[1-9][0-9]*}}
+
+// LOOP: error: 'loop.upper_bound' is not a hardware parameter of the program
+// LOOP: note: loop bounds are part of the program, edit it and resume, e.g. with -what-if-edit
+module {
+	func @graph() {
+		%m0 = equeue.create_mem [64], f32, SRAM
+		%m1 = equeue.create_mem [64], f32, SRAM
+		%dma = "equeue.create_dma"():()->i32
+		%a = equeue.alloc %m0, [4], f32 : !equeue.container<tensor<4xf32>, i32>
+		%b = equeue.alloc %m1, [4], f32 : !equeue.container<tensor<4xf32>, i32>
+		%c0 = constant 0 : index
+		%c1 = constant 1 : index
+		%c200 = constant 200 : index
+		%f = constant 1.0 : f32
+		scf.for %i = %c0 to %c200 step %c1 {
+			%x = addf %f, %f : f32
+		}
+		%start = "equeue.control_start"():()->!equeue.signal
+		%ab = "equeue.memcpy"(%start, %a, %b, %dma): (!equeue.signal, !equeue.container<tensor<4xf32>, i32>, !equeue.container<tensor<4xf32>, i32>, i32) -> !equeue.signal
+		"equeue.await"(%ab):(!equeue.signal)->()
+		return
+	}
+}
@@ -0,0 +1,30 @@
+// RUN: sed 's/constant 100 :/constant 50 :/' %s > %t.bound.mlir
+// RUN: equeue-opt %s -generate-input-file=false -what-if-edit=%t.bound.mlir -verify-incremental -json %t.json | FileCheck %s
+// RUN: sed 's/%y = addf %f, %f : f32/%y = addf %f, %f : f32\n%z = addf %f, %f : f32/' %s > %t.body.mlir
+// RUN: equeue-opt %s -generate-input-file=false -what-if-edit=%t.body.mlir -json %t.json | FileCheck %s --check-prefix=BODY
+
+// The bound of the second loop is a constant fetched after the first loop,
+// so halving it resumes from a checkpoint taken during the first loop and
+// matches the full rerun 50 cycles earlier.
+// CHECK: baseline time [[#BASE:]]
+// CHECK-NEXT: what-if time [[#BASE-50]], resumed at step {{[1-9][0-9]*}}
+
+// A second addf in the body adds an op, the edited input runs from the start.
+// BODY: baseline time [[#BASE:]]
+// BODY-NEXT: what-if time [[#BASE+100]]{{$}}
+module {
+	func @graph() {
+		%c0 = constant 0 : index
+		%c1 = constant 1 : index
+		%c200 = constant 200 : index
+		%f = constant 1.0 : f32
+		scf.for %i = %c0 to %c200 step %c1 {
+			%x = addf %f, %f : f32
+		}
+		%c100 = constant 100 : index
+		scf.for %j = %c0 to %c100 step %c1 {
+			%y = addf %f, %f : f32
+		}
+		return
+	}
+}
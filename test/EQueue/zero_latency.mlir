@@ -0,0 +1,19 @@
+// RUN: equeue-opt %s -generate-input-file=false -stats -json %t.json | FileCheck %s
+
+// Constants, the launch and the returns take no time, only the two addf do.
+// The host is done right after the launch; the accepted launch body still
+// runs to its end.
+// CHECK: simulated time: 3
+module {
+	func @graph() {
+		%core = equeue.create_proc ARMr5
+		%start = "equeue.control_start"():()->!equeue.signal
+		%done = equeue.launch () in (%start, %core) {
+			%c = constant 1.0 : f32
+			%x = addf %c, %c : f32
+			%y = addf %x, %c : f32
+			"equeue.return"():()->()
+		}
+		return
+	}
+}